@@ -0,0 +1,1106 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include "batch.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Hints the processor to fetch the given address into the cache.
+ *
+ * @param addr Address which will be accessed soon.
+ */
+#ifdef __GNUC__
+#define prefetch(addr) __builtin_prefetch(addr)
+#else
+#define prefetch(addr) ((void)(addr))
+#endif
+
+/**
+ * Sorted set of state names used to assign state indices.
+ */
+typedef struct _nameset nameset;
+
+struct _nameset {
+	tmname *names; /**< State names. */
+	size_t len;    /**< Amount of names. */
+	size_t cap;    /**< Amount of names which can be stored. */
+};
+
+/**
+ * Context used for filling a dense transition table.
+ */
+typedef struct _densectx densectx;
+
+struct _densectx {
+	tmdense *dense; /**< Table being filled. */
+	nameset *set;   /**< Names of all states. */
+	dtm *tm;        /**< Turing machine of the table. */
+};
+
+/**
+ * Run executed by ::interleave.
+ */
+typedef struct _coro coro;
+
+struct _coro {
+	lanetape tape;        /**< Tape of the run. */
+	size_t head;          /**< Head position. */
+	size_t idx;           /**< Index of the input. */
+	uint32_t state;       /**< Current state or DENSEHALT if halted. */
+	unsigned long steps;  /**< Amount of performed steps. */
+	const uint32_t *next; /**< Table entry of the next step. */
+};
+
+/**
+ * Configuration of a run executed by ::runtrie.
+ */
+typedef struct _trierun trierun;
+
+struct _trierun {
+	lanetape tape;       /**< Tape of the run. */
+	size_t head;         /**< Head position. */
+	size_t base;         /**< Position of the first input cell. */
+	uint32_t state;      /**< Current state. */
+	unsigned long steps; /**< Amount of performed steps. */
+	int accept;          /**< Whether the run accepted, once halted. */
+};
+
+/**
+ * Inputs of a batch arranged as the leaves of a trie by ::runtrie.
+ */
+typedef struct _trie trie;
+
+struct _trie {
+	tmdense *d;    /**< Dense table of the machine. */
+	tmbatch *b;    /**< Batch whose inputs are processed. */
+	size_t *order; /**< Input indices in lexicographical order. */
+
+	/**
+	 * Length of the longest common prefix of each input and its
+	 * predecessor in order. The first element is unused.
+	 */
+	size_t *lcp;
+};
+
+/**
+ * Batch whose inputs are sorted by ::runtrie, used by ::cmpinput.
+ */
+static tmbatch *sorted;
+
+/**
+ * Reads a file containing one input per line. A single newline at the
+ * end of the file is ignored.
+ *
+ * @param path Path of the file.
+ * @param bad Pointer to store the line index of the first invalid
+ * 	input at.
+ * @returns Pointer to the inputs or NULL on failure. If the file
+ * 	couldn't be read errno is set, if it contains an invalid input
+ * 	errno is set to zero.
+ */
+tmbatch *
+readbatch(char *path, size_t *bad)
+{
+	size_t i, j;
+	ssize_t len;
+	char *buf, *in;
+	tmbatch *b;
+
+	buf = NULL;
+	if ((len = readfile(&buf, path)) == -1)
+		return NULL;
+
+	b = emalloc(sizeof(tmbatch));
+	b->buf = buf;
+	b->len = (size_t)len;
+	b->n = splitlines(buf, (size_t)len, &b->off, &b->size);
+	b->accept = emalloc(b->n ? b->n : 1);
+	b->steps = emalloc((b->n ? b->n : 1) * sizeof(unsigned long));
+
+	for (i = 0; i < b->n; i++) {
+		in = buf + b->off[i];
+		for (j = 0; j < b->size[i]; j++) {
+			if (!isalnum((unsigned char)in[j]) || in[j] == BLANKCHAR) {
+				*bad = i;
+				freebatch(b);
+				errno = 0;
+				return NULL;
+			}
+		}
+	}
+
+	return b;
+}
+
+/**
+ * Frees all resources allocated for a batch.
+ *
+ * @param b Batch which should be freed.
+ */
+void
+freebatch(tmbatch *b)
+{
+	assert(b);
+
+	if (b->len)
+		munmap(b->buf, b->len);
+
+	free(b->off);
+	free(b->size);
+	free(b->accept);
+	free(b->steps);
+	free(b);
+}
+
+/**
+ * Writes the result of each input of a batch to the given stream, one
+ * line per input in the order of the input file.
+ *
+ * @param b Batch whose results should be written.
+ * @param stream Stream the results should be written to.
+ * @param steps Whether the amount of steps should be written as well.
+ */
+void
+writebatch(tmbatch *b, FILE *stream, int steps)
+{
+	size_t i;
+
+	for (i = 0; i < b->n; i++) {
+		fputs((b->accept[i]) ? "accept" : "reject", stream);
+		if (steps)
+			fprintf(stream, " %lu", b->steps[i]);
+		fputc('\n', stream);
+	}
+}
+
+/**
+ * Adds a state name to a name set. Duplicates are removed by
+ * ::sortnames.
+ *
+ * @param set Set the name should be added to.
+ * @param name Name which should be added.
+ */
+static void
+addname(nameset *set, tmname name)
+{
+	size_t cap;
+
+	if (set->len == set->cap) {
+		cap = (set->cap) ? set->cap * 2 : 64;
+		set->names = tagrealloc(MEM_OTHER, set->names,
+			set->cap * sizeof(tmname), cap * sizeof(tmname));
+		set->cap = cap;
+	}
+
+	set->names[set->len++] = name;
+}
+
+/**
+ * Adds the name of the next state of the given transition to the name
+ * set pointed to by the given void pointer.
+ *
+ * @param trans Transition whose next state should be added.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to the name set.
+ */
+static void
+addnext(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)state;
+
+	addname(arg, trans->nextstate);
+}
+
+/**
+ * Adds the name of the given state and the names of the states
+ * reachable from it to the name set pointed to by the given void
+ * pointer.
+ *
+ * @param state State whose name should be added.
+ * @param arg Void pointer to the name set.
+ */
+static void
+addnames(tmstate *state, void *arg)
+{
+	addname(arg, state->name);
+	eachtrans(state, addnext, arg);
+}
+
+/**
+ * Compares two state names, used for qsort(3) and bsearch(3).
+ *
+ * @param a Pointer to the first name.
+ * @param b Pointer to the second name.
+ * @returns An integer less than, equal to or greater than zero.
+ */
+static int
+cmpname(const void *a, const void *b)
+{
+	tmname x, y;
+
+	x = *(const tmname *)a;
+	y = *(const tmname *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Sorts the names of a name set and removes duplicates.
+ *
+ * @param set Set which should be sorted.
+ */
+static void
+sortnames(nameset *set)
+{
+	size_t i, n;
+
+	qsort(set->names, set->len, sizeof(tmname), cmpname);
+	for (n = 0, i = 0; i < set->len; i++)
+		if (!n || set->names[n - 1] != set->names[i])
+			set->names[n++] = set->names[i];
+	set->len = n;
+}
+
+/**
+ * Returns the index of a state name in a sorted name set.
+ *
+ * @pre The name must be part of the set.
+ * @param set Sorted name set.
+ * @param name Name whose index should be returned.
+ * @returns Index of the name.
+ */
+static uint32_t
+nameidx(nameset *set, tmname name)
+{
+	tmname *p;
+
+	p = bsearch(&name, set->names, set->len, sizeof(tmname), cmpname);
+	assert(p);
+	return (uint32_t)(p - set->names);
+}
+
+/**
+ * Stores a transition in the dense table of the given context.
+ *
+ * @param trans Transition which should be stored.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to the context.
+ */
+static void
+filltrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	densectx *ctx;
+	tmdense *d;
+	tmtape *t;
+	size_t row;
+
+	ctx = arg;
+	d = ctx->dense;
+	t = ctx->tm->tape;
+
+	row = nameidx(ctx->set, state->name);
+	d->table[row * d->ncols + t->codes[(unsigned char)trans->rsym]] =
+		nameidx(ctx->set, trans->nextstate) << 10 |
+		(uint32_t)t->codes[(unsigned char)trans->wsym] << 2 |
+		(uint32_t)trans->headdir;
+}
+
+/**
+ * Stores the flags and transitions of a state in the dense table of the
+ * given context.
+ *
+ * @param state State which should be stored.
+ * @param arg Void pointer to the context.
+ */
+static void
+fillstate(tmstate *state, void *arg)
+{
+	densectx *ctx;
+
+	ctx = arg;
+	if (state->dead)
+		ctx->dense->flags[nameidx(ctx->set, state->name)] |= DENSE_DEAD;
+	eachtrans(state, filltrans, arg);
+}
+
+/**
+ * Creates a dense transition table for the given turing machine. States
+ * which are referenced by transitions but aren't defined are assigned
+ * an index as well, they don't have any transitions.
+ *
+ * @pre Transitions must not be fused, see ::fuse.
+ * @param tm Turing machine whose transitions should be used.
+ * @returns Pointer to the table or NULL if the machine has too many
+ * 	states or symbols to be represented.
+ */
+tmdense *
+newdense(dtm *tm)
+{
+	size_t i, n, unknown;
+	nameset set;
+	densectx ctx;
+	tmdense *d;
+
+	set.names = NULL;
+	set.len = set.cap = 0;
+	addname(&set, tm->start);
+	eachstate(tm, addnames, &set);
+	sortnames(&set);
+
+	if (set.len >= DENSEMAXSTATES || tm->tape->nsyms > UCHAR_MAX) {
+		free(set.names);
+		return NULL;
+	}
+
+	d = emalloc(sizeof(tmdense));
+	d->nstates = set.len;
+	d->ncols = tm->tape->nsyms + 1;
+	d->start = nameidx(&set, tm->start);
+
+	n = (d->nstates + 1) * d->ncols;
+	d->table = emalloc(n * sizeof(uint32_t));
+	for (i = 0; i < n; i++)
+		d->table[i] = DENSEHALT;
+	for (i = 0; i < d->ncols; i++)
+		d->table[d->nstates * d->ncols + i] =
+			(uint32_t)d->nstates << 10 | (uint32_t)STAY;
+
+	d->flags = emalloc(d->nstates + 1);
+	for (i = 0; i <= d->nstates; i++)
+		d->flags[i] = (i < d->nstates &&
+			!isaccepting(tm, set.names[i])) ? DENSE_ACCEPT : 0;
+
+	unknown = tm->tape->nsyms;
+	for (i = 0; i <= UCHAR_MAX; i++)
+		d->codes[i] = (tm->tape->syms[tm->tape->codes[i]] == (char)i) ?
+			tm->tape->codes[i] : (unsigned char)unknown;
+
+	ctx.dense = d;
+	ctx.set = &set;
+	ctx.tm = tm;
+	eachstate(tm, fillstate, &ctx);
+
+	free(set.names);
+	return d;
+}
+
+/**
+ * Frees all resources allocated for a dense transition table.
+ *
+ * @param d Table which should be freed.
+ */
+void
+freedense(tmdense *d)
+{
+	assert(d);
+
+	free(d->table);
+	free(d->flags);
+	free(d);
+}
+
+/**
+ * Runs the given turing machine on each input of the batch one after
+ * another using the interpreter.
+ *
+ * @param tm Turing machine which should be run.
+ * @param b Batch whose inputs should be used.
+ */
+void
+runeach(dtm *tm, tmbatch *b)
+{
+	size_t i, max;
+	char *in;
+	dtm run;
+
+	for (max = 0, i = 0; i < b->n; i++)
+		if (b->size[i] > max)
+			max = b->size[i];
+	in = emalloc(max + 1);
+
+	for (i = 0; i < b->n; i++) {
+		memcpy(in, b->buf + b->off[i], b->size[i]);
+		in[b->size[i]] = '\0';
+
+		run = *tm;
+		run.tape = blanktape(tm->tape);
+		run.steps = 0;
+		appendtape(run.tape, in);
+
+		b->accept[i] = !runtm(&run);
+		b->steps[i] = run.steps;
+		freetape(run.tape);
+	}
+
+	free(in);
+}
+
+/**
+ * Grows the tape of a lane by doubling its size. The cells are moved
+ * to the middle of the new buffer.
+ *
+ * @param t Tape which should be grown.
+ * @returns Offset the cells were moved by.
+ */
+size_t
+growlane(lanetape *t)
+{
+	size_t delta;
+	unsigned char *cells;
+
+	delta = t->size / 2;
+	cells = emalloc(t->size * 2);
+	memset(cells, 0, delta);
+	memcpy(cells + delta, t->cells, t->size);
+	memset(cells + delta + t->size, 0, t->size - delta);
+
+	free(t->cells);
+	t->cells = cells;
+	t->size *= 2;
+
+	return delta;
+}
+
+/**
+ * Prepares the tape of a lane for the given input. The input is placed
+ * in the middle of the tape.
+ *
+ * @param d Dense table of the machine.
+ * @param t Tape of the lane.
+ * @param in Input which should be written.
+ * @param len Length of the input.
+ * @returns Index of the first input cell.
+ */
+size_t
+filllane(tmdense *d, lanetape *t, char *in, size_t len)
+{
+	size_t i, size, off;
+
+	for (size = LANETAPESIZ; size < len + LANETAPESIZ; size *= 2)
+		;
+
+	if (t->size != size && (t->size < size || t->size > LANETAPEMAX)) {
+		free(t->cells);
+		t->cells = emalloc(size);
+		t->size = size;
+	}
+	memset(t->cells, 0, t->size);
+
+	off = (t->size - len) / 2;
+	for (i = 0; i < len; i++)
+		t->cells[off + i] = d->codes[(unsigned char)in[i]];
+
+	return off;
+}
+
+/**
+ * Assigns the next input of the batch to a lane. Inputs whose result
+ * is known without running the machine, i.e. the empty input and any
+ * input if the initial state is dead, are skipped and their result is
+ * stored directly.
+ *
+ * @param d Dense table of the machine.
+ * @param b Batch whose inputs are processed.
+ * @param next Pointer to the index of the next input, updated.
+ * @param t Tape of the lane.
+ * @param idx Pointer to store the index of the assigned input at.
+ * @param head Pointer to store the initial head position at.
+ * @returns 1 if an input was assigned, 0 if no inputs are left.
+ */
+static int
+refill(tmdense *d, tmbatch *b, size_t *next, lanetape *t,
+		size_t *idx, size_t *head)
+{
+	size_t i;
+	unsigned char flags;
+
+	flags = d->flags[d->start];
+	while ((i = (*next)++) < b->n) {
+		b->steps[i] = 0;
+		if (!b->size[i]) {
+			b->accept[i] = flags & DENSE_ACCEPT;
+			continue;
+		} else if (flags & DENSE_DEAD) {
+			b->accept[i] = 0;
+			continue;
+		}
+
+		*idx = i;
+		*head = filllane(d, t, b->buf + b->off[i], b->size[i]);
+		return 1;
+	}
+
+	*next = b->n;
+	return 0;
+}
+
+/**
+ * Runs a turing machine on each input of the batch, executing LANES
+ * inputs in lockstep. In each step the current symbol of every lane is
+ * gathered, the transitions of all lanes are looked up in the dense
+ * table and the writes and head movements are applied. The loops over
+ * the lanes don't depend on each other and can be vectorized by the
+ * compiler. Lanes whose input halted are refilled with the next input,
+ * lanes without remaining inputs execute the idle row of the table.
+ *
+ * The results are equal to those of ::runeach, the machine must not
+ * have fused transitions.
+ *
+ * @param d Dense table of the turing machine.
+ * @param b Batch whose inputs should be used.
+ */
+void
+lockstep(tmdense *d, tmbatch *b)
+{
+	int halted;
+	size_t l, next, active, idx[LANES];
+	size_t head[LANES];
+	uint32_t state[LANES], ent[LANES];
+	unsigned char sym[LANES];
+	unsigned long steps[LANES];
+	unsigned char idle[3];
+	unsigned char *cells[LANES];
+	lanetape tapes[LANES];
+	uint32_t park;
+
+	park = (uint32_t)d->nstates;
+	memset(idle, 0, sizeof(idle));
+	next = active = 0;
+	for (l = 0; l < LANES; l++) {
+		tapes[l].cells = NULL;
+		tapes[l].size = 0;
+		state[l] = DENSEHALT;
+	}
+
+	for (;;) {
+		for (l = 0; l < LANES; l++) {
+			if (state[l] == DENSEHALT && refill(d, b, &next,
+					&tapes[l], &idx[l], &head[l])) {
+				cells[l] = tapes[l].cells;
+				state[l] = d->start;
+				steps[l] = 0;
+				active++;
+			} else if (state[l] == DENSEHALT) {
+				cells[l] = idle;
+				head[l] = 1;
+				state[l] = park;
+			}
+		}
+		if (!active)
+			break;
+
+		for (l = 0; l < LANES; l++)
+			sym[l] = cells[l][head[l]];
+		for (l = 0; l < LANES; l++)
+			ent[l] = d->table[state[l] * d->ncols + sym[l]];
+
+		/* Halted lanes are refilled before the next step. */
+		for (halted = 0, l = 0; l < LANES; l++) {
+			if (ent[l] != DENSEHALT)
+				continue;
+			b->accept[idx[l]] = d->flags[state[l]] & DENSE_ACCEPT;
+			b->steps[idx[l]] = steps[l];
+			state[l] = DENSEHALT;
+			active--;
+			halted = 1;
+		}
+		if (halted)
+			continue;
+
+		for (l = 0; l < LANES; l++) {
+			cells[l][head[l]] = densesym(ent[l]);
+			head[l] += (size_t)(densedir(ent[l]) == RIGHT) -
+				(size_t)(densedir(ent[l]) == LEFT);
+			state[l] = densenext(ent[l]);
+			steps[l]++;
+		}
+
+		for (l = 0; l < LANES; l++) {
+			if (state[l] == park)
+				continue;
+			if (d->flags[state[l]] & DENSE_DEAD) {
+				b->accept[idx[l]] = 0;
+				b->steps[idx[l]] = steps[l];
+				state[l] = DENSEHALT;
+				active--;
+			} else if (head[l] - 1 >= tapes[l].size - 2) {
+				head[l] += growlane(&tapes[l]);
+				cells[l] = tapes[l].cells;
+			}
+		}
+	}
+
+	for (l = 0; l < LANES; l++)
+		free(tapes[l].cells);
+}
+
+/**
+ * Selects the engine used for the given dense table. Tables which fit
+ * into the cache are run in lockstep, larger ones are interleaved to
+ * overlap the cache misses of the table lookups.
+ *
+ * @param d Dense table or NULL if the machine couldn't be converted.
+ * @returns Engine which should be used.
+ */
+tmengine
+batchengine(tmdense *d)
+{
+	if (!d)
+		return ENGINE_EACH;
+	if ((d->nstates + 1) * d->ncols * sizeof(uint32_t) > DENSECACHE)
+		return ENGINE_INTERLEAVE;
+	return ENGINE_LOCKSTEP;
+}
+
+/**
+ * Assigns the next input of the batch to a run and prefetches the
+ * table entry of its first step.
+ *
+ * @param d Dense table of the machine.
+ * @param b Batch whose inputs are processed.
+ * @param next Pointer to the index of the next input, updated.
+ * @param c Run which should be started.
+ * @returns 1 if an input was assigned, 0 if no inputs are left.
+ */
+static int
+startcoro(tmdense *d, tmbatch *b, size_t *next, coro *c)
+{
+	if (!refill(d, b, next, &c->tape, &c->idx, &c->head)) {
+		c->state = DENSEHALT;
+		return 0;
+	}
+
+	c->state = d->start;
+	c->steps = 0;
+	c->next = &d->table[c->state * d->ncols + c->tape.cells[c->head]];
+	prefetch(c->next);
+	return 1;
+}
+
+/**
+ * Performs a single step of a run and prefetches the table entry of
+ * its next step.
+ *
+ * @param d Dense table of the machine.
+ * @param b Batch whose inputs are processed.
+ * @param c Run which should perform a step.
+ * @returns 0 if the run continues, -1 if it halted.
+ */
+static int
+stepcoro(tmdense *d, tmbatch *b, coro *c)
+{
+	uint32_t ent;
+
+	if ((ent = *c->next) == DENSEHALT) {
+		b->accept[c->idx] = d->flags[c->state] & DENSE_ACCEPT;
+		b->steps[c->idx] = c->steps;
+		return -1;
+	}
+
+	c->tape.cells[c->head] = densesym(ent);
+	if (densedir(ent) == RIGHT)
+		c->head++;
+	else if (densedir(ent) == LEFT)
+		c->head--;
+	c->state = densenext(ent);
+	c->steps++;
+
+	if (d->flags[c->state] & DENSE_DEAD) {
+		b->accept[c->idx] = 0;
+		b->steps[c->idx] = c->steps;
+		return -1;
+	} else if (c->head - 1 >= c->tape.size - 2) {
+		c->head += growlane(&c->tape);
+	}
+
+	c->next = &d->table[c->state * d->ncols + c->tape.cells[c->head]];
+	prefetch(c->next);
+	return 0;
+}
+
+/**
+ * Runs a turing machine on each input of the batch, executing
+ * INTERLEAVE inputs in a round-robin fashion on a single thread. After
+ * each step of a run the table entry of its next step is prefetched
+ * and the next run is continued, the cache misses of the table lookups
+ * of different runs thus overlap. Intended for tables which don't fit
+ * into the cache.
+ *
+ * The results are equal to those of ::runeach, the machine must not
+ * have fused transitions.
+ *
+ * @param d Dense table of the turing machine.
+ * @param b Batch whose inputs should be used.
+ */
+void
+interleave(tmdense *d, tmbatch *b)
+{
+	size_t r, next, active;
+	coro runs[INTERLEAVE];
+
+	next = active = 0;
+	for (r = 0; r < INTERLEAVE; r++) {
+		runs[r].tape.cells = NULL;
+		runs[r].tape.size = 0;
+		if (startcoro(d, b, &next, &runs[r]))
+			active++;
+	}
+
+	while (active) {
+		for (r = 0; r < INTERLEAVE; r++) {
+			if (runs[r].state == DENSEHALT ||
+					!stepcoro(d, b, &runs[r]))
+				continue;
+			if (!startcoro(d, b, &next, &runs[r]))
+				active--;
+		}
+	}
+
+	for (r = 0; r < INTERLEAVE; r++)
+		free(runs[r].tape.cells);
+}
+
+/**
+ * Compares two inputs of the batch being sorted lexicographically,
+ * used for qsort(3).
+ *
+ * @param a Pointer to the index of the first input.
+ * @param b Pointer to the index of the second input.
+ * @returns An integer less than, equal to or greater than zero.
+ */
+static int
+cmpinput(const void *a, const void *b)
+{
+	int r;
+	size_t x, y, len;
+
+	x = *(const size_t *)a;
+	y = *(const size_t *)b;
+	len = (sorted->size[x] < sorted->size[y]) ?
+		sorted->size[x] : sorted->size[y];
+
+	if ((r = memcmp(sorted->buf + sorted->off[x],
+			sorted->buf + sorted->off[y], len)))
+		return r;
+	return (sorted->size[x] > sorted->size[y]) -
+		(sorted->size[x] < sorted->size[y]);
+}
+
+/**
+ * Grows the tape of a run until the given position and the cells
+ * adjacent to it are part of the buffer.
+ *
+ * @param r Run whose tape should be grown.
+ * @param pos Position relative to the first input cell.
+ */
+static void
+reservetrie(trierun *r, size_t pos)
+{
+	size_t delta;
+
+	while (r->base + pos + 1 >= r->tape.size) {
+		delta = growlane(&r->tape);
+		r->head += delta;
+		r->base += delta;
+	}
+}
+
+/**
+ * Performs steps of a run until it halts or, if depth isn't SIZE_MAX,
+ * until the head reaches the cell at the given depth of the input.
+ * This cell hasn't been accessed yet, its content depends on the input.
+ *
+ * @param d Dense table of the machine.
+ * @param r Run which should be continued.
+ * @param depth Amount of input cells known to the run or SIZE_MAX.
+ * @returns 1 if the run halted, 0 if it reached the given depth.
+ */
+static int
+advance(tmdense *d, trierun *r, size_t depth)
+{
+	uint32_t ent;
+	size_t front, delta;
+
+	front = (depth == SIZE_MAX) ? SIZE_MAX : r->base + depth;
+	while (r->head != front) {
+		ent = d->table[r->state * d->ncols + r->tape.cells[r->head]];
+		if (ent == DENSEHALT) {
+			r->accept = d->flags[r->state] & DENSE_ACCEPT;
+			return 1;
+		}
+
+		r->tape.cells[r->head] = densesym(ent);
+		if (densedir(ent) == RIGHT)
+			r->head++;
+		else if (densedir(ent) == LEFT)
+			r->head--;
+		r->state = densenext(ent);
+		r->steps++;
+
+		if (d->flags[r->state] & DENSE_DEAD) {
+			r->accept = 0;
+			return 1;
+		} else if (r->head - 1 >= r->tape.size - 2) {
+			delta = growlane(&r->tape);
+			r->head += delta;
+			r->base += delta;
+			if (depth != SIZE_MAX)
+				front = r->base + depth;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Copies the configuration of a run.
+ *
+ * @param dest Run the configuration should be copied to.
+ * @param src Run which should be copied.
+ */
+static void
+forktrie(trierun *dest, trierun *src)
+{
+	*dest = *src;
+	dest->tape.cells = emalloc(src->tape.size);
+	memcpy(dest->tape.cells, src->tape.cells, src->tape.size);
+}
+
+/**
+ * Stores the result of a halted run for the given inputs.
+ *
+ * @param t Trie of the inputs.
+ * @param lo Index of the first input in the trie order.
+ * @param hi Index after the last input in the trie order.
+ * @param r Halted run.
+ */
+static void
+storetrie(trie *t, size_t lo, size_t hi, trierun *r)
+{
+	for (; lo < hi; lo++) {
+		t->b->accept[t->order[lo]] = (unsigned char)r->accept;
+		t->b->steps[t->order[lo]] = r->steps;
+	}
+}
+
+/**
+ * Writes a part of an input to the tape of a run.
+ *
+ * @param t Trie of the inputs.
+ * @param r Run whose tape should be written.
+ * @param idx Index of the input in the trie order.
+ * @param from Position of the first symbol which should be written.
+ * @param to Position after the last symbol which should be written.
+ */
+static void
+writetrie(trie *t, trierun *r, size_t idx, size_t from, size_t to)
+{
+	char *str;
+
+	reservetrie(r, to);
+	str = t->b->buf + t->b->off[t->order[idx]];
+	for (; from < to; from++)
+		r->tape.cells[r->base + from] =
+			t->d->codes[(unsigned char)str[from]];
+}
+
+/**
+ * Returns the end of the group of inputs starting at the given index
+ * which share the symbol following a common prefix of the given length.
+ * Inputs ending after the prefix are sorted first and form a group.
+ *
+ * @param t Trie of the inputs.
+ * @param i Index of the first input of the group in the trie order.
+ * @param hi Index after the last input sharing the prefix.
+ * @param depth Length of the shared prefix.
+ * @returns Index after the last input of the group.
+ */
+static size_t
+groupend(trie *t, size_t i, size_t hi, size_t depth)
+{
+	size_t j;
+
+	if (t->b->size[t->order[i]] == depth) {
+		for (j = i + 1; j < hi && t->b->size[t->order[j]] == depth; j++)
+			;
+	} else {
+		for (j = i + 1; j < hi && t->lcp[j] > depth; j++)
+			;
+	}
+
+	return j;
+}
+
+/**
+ * Runs the inputs with the given indices in the trie order, which share
+ * a prefix of the given length, starting from a configuration which
+ * only accessed this prefix. The prefix is first extended to the
+ * longest one shared by all inputs. The run is then continued until it
+ * reads the cell after the prefix, the inputs are split by the symbol
+ * of that cell and the configuration is forked for each group. The
+ * largest group continues in the given configuration, the recursion
+ * depth is thus logarithmic.
+ *
+ * @param t Trie of the inputs.
+ * @param lo Index of the first input in the trie order.
+ * @param hi Index after the last input in the trie order.
+ * @param depth Length of the shared prefix.
+ * @param r Configuration after reading the prefix, freed on return.
+ */
+static void
+trienode(trie *t, size_t lo, size_t hi, size_t depth, trierun *r)
+{
+	size_t i, j, len, big, blo, bhi;
+	trierun fork;
+
+	for (;;) {
+		/* A single input is written entirely and run to the end. */
+		if (hi - lo == 1) {
+			writetrie(t, r, lo, depth, t->b->size[t->order[lo]]);
+			advance(t->d, r, SIZE_MAX);
+			break;
+		}
+
+		for (len = SIZE_MAX, i = lo + 1; i < hi; i++)
+			if (t->lcp[i] < len)
+				len = t->lcp[i];
+		writetrie(t, r, lo, depth, len);
+		if (advance(t->d, r, (depth = len)))
+			break;
+
+		/* Find the largest group, it continues in this run. */
+		big = 0;
+		blo = bhi = lo;
+		for (i = lo; i < hi; i = j) {
+			if ((j = groupend(t, i, hi, depth)) - i > big) {
+				big = j - i;
+				blo = i;
+				bhi = j;
+			}
+		}
+
+		for (i = lo; i < hi; i = j) {
+			j = groupend(t, i, hi, depth);
+			if (i == blo)
+				continue;
+
+			forktrie(&fork, r);
+			if (t->b->size[t->order[i]] == depth) {
+				/* Identical inputs, the remaining tape is blank. */
+				advance(t->d, &fork, SIZE_MAX);
+				storetrie(t, i, j, &fork);
+				free(fork.tape.cells);
+			} else {
+				writetrie(t, &fork, i, depth, depth + 1);
+				trienode(t, i, j, depth + 1, &fork);
+			}
+		}
+
+		lo = blo;
+		hi = bhi;
+		if (t->b->size[t->order[lo]] == depth) {
+			advance(t->d, r, SIZE_MAX);
+			break;
+		}
+
+		writetrie(t, r, lo, depth, depth + 1);
+		depth++;
+	}
+
+	storetrie(t, lo, hi, r);
+	free(r->tape.cells);
+}
+
+/**
+ * Runs a turing machine on each input of the batch, sharing the steps
+ * performed on common prefixes of the inputs. The inputs are sorted,
+ * which arranges them as the leaves of a trie, and the machine is run
+ * once per trie node: until the head first reads a cell beyond the
+ * prefix of the node. The configuration is then forked for each child
+ * node. Deciders scanning their input from left to right thus only
+ * perform steps proportional to the size of the trie.
+ *
+ * The results are equal to those of ::runeach, the machine must not
+ * have fused transitions.
+ *
+ * @param d Dense table of the turing machine.
+ * @param b Batch whose inputs should be used.
+ */
+void
+runtrie(tmdense *d, tmbatch *b)
+{
+	size_t i, lo, len;
+	char *x, *y;
+	trie t;
+	trierun r;
+
+	t.d = d;
+	t.b = b;
+	t.order = emalloc((b->n ? b->n : 1) * sizeof(size_t));
+	t.lcp = emalloc((b->n ? b->n : 1) * sizeof(size_t));
+	for (i = 0; i < b->n; i++)
+		t.order[i] = i;
+
+	sorted = b;
+	qsort(t.order, b->n, sizeof(size_t), cmpinput);
+	sorted = NULL;
+
+	for (i = 1; i < b->n; i++) {
+		x = b->buf + b->off[t.order[i - 1]];
+		y = b->buf + b->off[t.order[i]];
+		len = b->size[t.order[i - 1]];
+		for (t.lcp[i] = 0; t.lcp[i] < len && x[t.lcp[i]] == y[t.lcp[i]];)
+			t.lcp[i]++;
+	}
+
+	/* The empty input doesn't run, see ::runtm. */
+	for (lo = 0; lo < b->n && !b->size[t.order[lo]]; lo++) {
+		b->accept[t.order[lo]] = d->flags[d->start] & DENSE_ACCEPT;
+		b->steps[t.order[lo]] = 0;
+	}
+
+	if (lo < b->n && (d->flags[d->start] & DENSE_DEAD)) {
+		for (; lo < b->n; lo++) {
+			b->accept[t.order[lo]] = 0;
+			b->steps[t.order[lo]] = 0;
+		}
+	} else if (lo < b->n) {
+		r.tape.cells = NULL;
+		r.tape.size = 0;
+		r.base = filllane(d, &r.tape, "", 0);
+		r.head = r.base;
+		r.state = d->start;
+		r.steps = 0;
+		trienode(&t, lo, b->n, 0, &r);
+	}
+
+	free(t.order);
+	free(t.lcp);
+}
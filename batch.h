@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_BATCH_H
+#define TMSIM_BATCH_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sys/types.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Amount of inputs executed in lockstep by ::lockstep.
+	 */
+	LANES = 16,
+
+	/**
+	 * Amount of inputs executed in an interleaved fashion by
+	 * ::interleave.
+	 */
+	INTERLEAVE = 8,
+
+	/**
+	 * Size in bytes up to which a dense transition table is assumed
+	 * to fit into the cache, see ::batchengine.
+	 */
+	DENSECACHE = 1 << 18,
+
+	/**
+	 * Amount of cells initially allocated for the tape of a lane.
+	 */
+	LANETAPESIZ = 256,
+
+	/**
+	 * Tapes of lanes which grew beyond this amount of cells are
+	 * reallocated instead of being cleared for the next input.
+	 */
+	LANETAPEMAX = 1 << 12,
+
+	/**
+	 * Maximum amount of states of a dense transition table. State
+	 * indices are stored in the upper 22 bits of a table entry.
+	 */
+	DENSEMAXSTATES = 1 << 22,
+
+	DENSE_ACCEPT = 1 << 0, /**< Flag of accepting states. */
+	DENSE_DEAD = 1 << 1,   /**< Flag of states marked by ::markdead. */
+};
+
+/**
+ * Table entry used for (state, symbol) pairs without a transition.
+ */
+#define DENSEHALT UINT32_MAX
+
+/**
+ * Engine used to run the inputs of a batch.
+ */
+typedef enum {
+	ENGINE_AUTO,       /**< Select an engine, see ::batchengine. */
+	ENGINE_EACH,       /**< Use the interpreter, see ::runeach. */
+	ENGINE_LOCKSTEP,   /**< See ::lockstep. */
+	ENGINE_INTERLEAVE, /**< See ::interleave. */
+	ENGINE_TRIE,       /**< See ::runtrie. */
+} tmengine;
+
+/**
+ * Inputs of a batch run and their results. Inputs are stored in a
+ * read-only mapping of the input file, one input per line.
+ */
+typedef struct _tmbatch tmbatch;
+
+struct _tmbatch {
+	char *buf;  /**< Mapped input file. */
+	size_t len; /**< Length of the input file. */
+
+	size_t n;     /**< Amount of inputs. */
+	size_t *off;  /**< Offset of each input in buf. */
+	size_t *size; /**< Length of each input. */
+
+	unsigned char *accept; /**< Whether the machine accepted each input. */
+	unsigned long *steps;  /**< Amount of steps performed for each input. */
+};
+
+/**
+ * Transition table of a turing machine as a dense two-dimensional array
+ * indexed by state index and symbol code. Each entry packs the index of
+ * the next state, the code of the written symbol and the head direction.
+ */
+typedef struct _tmdense tmdense;
+
+struct _tmdense {
+	/**
+	 * Entries, nstates rows of ncols entries. An additional row
+	 * follows the last state, it loops on any symbol without modifying
+	 * the tape and is used for idle lanes by ::lockstep.
+	 */
+	uint32_t *table;
+
+	unsigned char *flags; /**< Flags of each state, see ::DENSE_ACCEPT. */
+	size_t nstates;       /**< Amount of states including undefined ones. */
+	size_t ncols;         /**< Amount of symbol codes including unknown. */
+	uint32_t start;       /**< Index of the initial state. */
+
+	/**
+	 * Code of each input character. Characters which aren't part of
+	 * the tape alphabet are mapped to an additional code without any
+	 * transitions.
+	 */
+	unsigned char codes[UCHAR_MAX + 1];
+};
+
+/**
+ * Tape used by the batch engines, one byte per cell. Cells store the
+ * symbol codes of a dense transition table.
+ */
+typedef struct _lanetape lanetape;
+
+struct _lanetape {
+	unsigned char *cells; /**< Symbol code of each cell. */
+	size_t size;          /**< Amount of cells. */
+};
+
+/**
+ * Extracts the index of the next state from a dense table entry.
+ *
+ * @param ent Table entry.
+ * @returns Index of the next state.
+ */
+static inline uint32_t
+densenext(uint32_t ent)
+{
+	return ent >> 10;
+}
+
+/**
+ * Extracts the code of the written symbol from a dense table entry.
+ *
+ * @param ent Table entry.
+ * @returns Code of the written symbol.
+ */
+static inline unsigned char
+densesym(uint32_t ent)
+{
+	return (unsigned char)((ent >> 2) & 0xff);
+}
+
+/**
+ * Extracts the head direction from a dense table entry.
+ *
+ * @param ent Table entry.
+ * @returns Direction the head is moved in.
+ */
+static inline direction
+densedir(uint32_t ent)
+{
+	return (direction)(ent & 0x3);
+}
+
+tmbatch *readbatch(char *, size_t *);
+void freebatch(tmbatch *);
+void writebatch(tmbatch *, FILE *, int);
+
+tmdense *newdense(dtm *);
+void freedense(tmdense *);
+
+size_t growlane(lanetape *);
+size_t filllane(tmdense *, lanetape *, char *, size_t);
+
+tmengine batchengine(tmdense *);
+void runeach(dtm *, tmbatch *);
+void lockstep(tmdense *, tmbatch *);
+void interleave(tmdense *, tmbatch *);
+void runtrie(tmdense *, tmbatch *);
+
+#endif
@@ -0,0 +1,842 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Busy beaver candidates are enumerated in tree normal form: starting
+ * with a machine without any transitions, a machine is simulated on the
+ * blank tape until it reaches an undefined transition. The machine is
+ * then extended with each possible choice for this transition, i.e. a
+ * halting transition or any combination of written symbol, direction
+ * and next state. Only transitions the simulation actually needs are
+ * ever defined.
+ *
+ * Isomorphic machines are avoided by canonical renaming: a transition
+ * may only switch to a state or write a symbol which was used before or
+ * to the lowest unused one, and the first transition moves right.
+ *
+ * State qN is the N-th state (A, B, ... in the compact notation), q0 is
+ * the accepting halting state. Symbol 0 is the blank, symbol N is the
+ * digit N.
+ */
+enum {
+	BBMAXSTATES = 8,  /**< Maximum amount of states. */
+	BBMAXSYMS = 10,   /**< Maximum amount of symbols. */
+	BBSTEPS = 1 << 12, /**< Default maximum amount of steps. */
+	BBHALT = 0,       /**< Name of the halting state. */
+	BBUNDEF = -1,     /**< Next state of an undefined transition. */
+};
+
+/**
+ * Result of simulating a candidate.
+ */
+typedef enum {
+	BB_EXTEND,     /**< An undefined transition was reached. */
+	BB_CYCLER,     /**< The machine repeats a configuration. */
+	BB_TRANSLATED, /**< The machine repeats a translated configuration. */
+	BB_HOLDOUT,    /**< The step limit was reached undecided. */
+} bbres;
+
+/**
+ * Candidate machine, a node of the tree normal form.
+ */
+typedef struct _bbnode bbnode;
+
+struct _bbnode {
+	signed char next[BBMAXSTATES][BBMAXSYMS]; /**< Next state or BBUNDEF. */
+	unsigned char wsym[BBMAXSTATES][BBMAXSYMS]; /**< Written symbol. */
+	unsigned char dir[BBMAXSTATES][BBMAXSYMS];  /**< Head direction. */
+
+	unsigned char maxstate; /**< Highest state used so far. */
+	unsigned char maxsym;   /**< Highest symbol written so far. */
+	unsigned char ndefined; /**< Amount of defined transitions. */
+};
+
+/**
+ * Configuration saved by a decider. Positions are relative to the
+ * initial head position.
+ */
+typedef struct _snapshot snapshot;
+
+struct _snapshot {
+	tmname state;  /**< State of the machine. */
+	long pos;      /**< Position of the head. */
+	long lo;       /**< Position of the first saved cell. */
+	size_t len;    /**< Amount of saved cells. */
+	size_t size;   /**< Amount of cells the buffer can hold. */
+	unsigned char *cells; /**< Symbol code of each saved cell. */
+};
+
+/**
+ * Pending candidates of a worker. The worker takes candidates from
+ * the top, idle workers steal candidates from the bottom.
+ */
+typedef struct _bbdeque bbdeque;
+
+struct _bbdeque {
+	bbnode *nodes;  /**< Buffer of candidates. */
+	size_t lo, hi;  /**< Range of pending candidates in the buffer. */
+	size_t size;    /**< Amount of candidates the buffer can hold. */
+	pthread_mutex_t lock; /**< Protects the deque. */
+};
+
+/**
+ * Halting candidate with the most steps or the most non-blank cells.
+ */
+typedef struct _champion champion;
+
+struct _champion {
+	bbnode node;          /**< The candidate, valid if steps is non-zero. */
+	unsigned long steps;  /**< Amount of steps until it halted. */
+	unsigned long sigma;  /**< Amount of non-blank cells left on the tape. */
+};
+
+/**
+ * Worker state, results are merged once all workers finished.
+ */
+typedef struct _bbworker bbworker;
+
+struct _bbworker {
+	unsigned int id; /**< Index of the worker and its deque. */
+	dtm *tm;         /**< Machine the candidates are loaded into. */
+	snapshot cycle;  /**< Configuration saved by the cycler. */
+	snapshot edges[2]; /**< Record configurations of each side. */
+
+	uint64_t counts[BB_HOLDOUT + 1]; /**< Amount of candidates per result. */
+	uint64_t halted;   /**< Amount of halting candidates. */
+	champion best[2];  /**< Most steps and most non-blank cells. */
+};
+
+static unsigned int nstates, nsyms;
+static unsigned long limit;
+
+static bbdeque *deques;
+static unsigned int nworkers;
+
+/**
+ * Amount of candidates which were pushed but not processed yet and
+ * amount of workers waiting for candidates. Protected by poollock.
+ */
+static uint64_t pending;
+static unsigned int nidle;
+static pthread_mutex_t poollock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolcond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Stream holdouts are written to, protected by outlock.
+ */
+static FILE *out;
+static pthread_mutex_t outlock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Writes the usage string for this program to stderr and terminates
+ * the program with EXIT_FAILURE.
+ */
+static void
+usage(char *prog)
+{
+	fprintf(stderr, "USAGE: %s %s\n", prog,
+		"[-n steps] [-j threads] [-o output] [-h|-v] STATES SYMBOLS");
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Returns the tape symbol of the given symbol number.
+ *
+ * @param sym Number of the symbol.
+ * @returns Tape symbol.
+ */
+static char
+symchar(unsigned int sym)
+{
+	return (sym) ? (char)('0' + sym) : BLANKCHAR;
+}
+
+/**
+ * Writes a candidate in the compact notation, e.g. 1RB1LB_1LA1RZ.
+ * Undefined transitions are written as ---, halting ones go to Z.
+ *
+ * @param nd Candidate which should be written.
+ * @param stream Stream to write the candidate to.
+ */
+static void
+writenode(bbnode *nd, FILE *stream)
+{
+	unsigned int s, c;
+
+	for (s = 0; s < nstates; s++) {
+		if (s)
+			putc('_', stream);
+		for (c = 0; c < nsyms; c++) {
+			if (nd->next[s][c] == BBUNDEF) {
+				fputs("---", stream);
+				continue;
+			}
+
+			putc('0' + nd->wsym[s][c], stream);
+			putc((nd->dir[s][c] == LEFT) ? 'L' : 'R', stream);
+			putc((nd->next[s][c] == BBHALT) ? 'Z' :
+				'A' + nd->next[s][c] - 1, stream);
+		}
+	}
+}
+
+/**
+ * Loads the transitions of a candidate into the machine of a worker.
+ *
+ * @param w Worker whose machine should be updated.
+ * @param nd Candidate which should be loaded.
+ */
+static void
+loadnode(bbworker *w, bbnode *nd)
+{
+	unsigned int s, c;
+	tmstate *state;
+	tmtrans *trans;
+
+	for (s = 0; s < nstates; s++) {
+		if (getstate(w->tm, (tmname)s + 1, &state))
+			die("missing state");
+
+		for (c = 0; c < nsyms; c++) {
+			if (nd->next[s][c] == BBUNDEF) {
+				(void)deltrans(state, symchar(c));
+				continue;
+			}
+
+			if (gettrans(state, symchar(c), &trans)) {
+				trans = newtrans();
+				trans->rsym = symchar(c);
+				if (addtrans(state, trans))
+					die("addtrans failed");
+			}
+
+			trans->wsym = symchar(nd->wsym[s][c]);
+			trans->headdir = (direction)nd->dir[s][c];
+			trans->nextstate = nd->next[s][c];
+		}
+	}
+}
+
+/**
+ * Saves the accessed cells of a tape.
+ *
+ * @param s Snapshot to save the configuration in.
+ * @param t Tape which should be saved.
+ * @param state Current state of the machine.
+ * @param pos Current position of the head.
+ */
+static void
+savesnap(snapshot *s, tmtape *t, tmname state, long pos)
+{
+	size_t i;
+
+	s->len = t->hi - t->lo + 1;
+	if (s->len > s->size) {
+		s->cells = tagrealloc(MEM_OTHER, s->cells, s->size, s->len * 2);
+		s->size = s->len * 2;
+	}
+
+	for (i = 0; i < s->len; i++)
+		s->cells[i] = (unsigned char)getcell(t, t->lo + i);
+
+	s->state = state;
+	s->pos = pos;
+	s->lo = pos - (long)(t->head - t->lo);
+}
+
+/**
+ * Reads a cell of a snapshot, cells which weren't saved are blank.
+ *
+ * @param s Snapshot to read from.
+ * @param p Position of the cell.
+ * @returns Symbol code of the cell.
+ */
+static unsigned int
+snapcell(snapshot *s, long p)
+{
+	if (p < s->lo || p >= s->lo + (long)s->len)
+		return 0;
+	return s->cells[p - s->lo];
+}
+
+/**
+ * Reads a cell of a tape, cells which weren't accessed are blank.
+ *
+ * @param t Tape to read from.
+ * @param pos Current position of the head.
+ * @param p Position of the cell.
+ * @returns Symbol code of the cell.
+ */
+static unsigned int
+tapecell(tmtape *t, long pos, long p)
+{
+	long idx;
+
+	idx = (long)t->head + (p - pos);
+	if (idx < (long)t->lo || idx > (long)t->hi)
+		return 0;
+	return getcell(t, (size_t)idx);
+}
+
+/**
+ * Compares the cells of a snapshot with the cells of a tape.
+ *
+ * @param s Snapshot to compare.
+ * @param t Tape to compare.
+ * @param pos Current position of the head.
+ * @param lo Position of the first compared snapshot cell.
+ * @param hi Position of the last compared snapshot cell.
+ * @param shift Distance between the compared cells of the tape and
+ * 	the snapshot.
+ * @returns Non-zero if all compared cells are equal.
+ */
+static int
+samecells(snapshot *s, tmtape *t, long pos, long lo, long hi, long shift)
+{
+	long p;
+
+	for (p = lo; p <= hi; p++)
+		if (snapcell(s, p) != tapecell(t, pos, p + shift))
+			return 0;
+
+	return 1;
+}
+
+/**
+ * Counts the non-blank cells of a tape.
+ *
+ * @param t Tape whose cells should be counted.
+ * @returns Amount of non-blank cells.
+ */
+static unsigned long
+countsyms(tmtape *t)
+{
+	size_t i;
+	unsigned long n;
+
+	for (n = 0, i = t->lo; i <= t->hi; i++)
+		if (getcell(t, i))
+			n++;
+
+	return n;
+}
+
+/**
+ * Records a halting candidate if it beats the current champions of a
+ * worker. Ties are broken by the compact notation of the candidates,
+ * the champions are thus independent of the amount of workers.
+ *
+ * @param best Champions of a worker, most steps first.
+ * @param nd Halting candidate.
+ * @param steps Amount of steps until it halted.
+ * @param sigma Amount of non-blank cells left on the tape.
+ */
+static void
+addchampion(champion *best, bbnode *nd, unsigned long steps,
+		unsigned long sigma)
+{
+	int i;
+	unsigned long score, cur;
+
+	for (i = 0; i < 2; i++) {
+		score = (i) ? sigma : steps;
+		cur = (i) ? best[i].sigma : best[i].steps;
+		if (best[i].steps && (score < cur || (score == cur &&
+				memcmp(nd, &best[i].node, sizeof(*nd)) >= 0)))
+			continue;
+
+		best[i].node = *nd;
+		best[i].steps = steps;
+		best[i].sigma = sigma;
+	}
+}
+
+/**
+ * Pushes a candidate onto the top of a deque.
+ *
+ * @param q Deque the candidate should be pushed to.
+ * @param nd Candidate which should be pushed.
+ */
+static void
+pushnode(bbdeque *q, bbnode *nd)
+{
+	size_t size;
+
+	pthread_mutex_elock(&q->lock);
+	if (q->hi == q->size) {
+		if (q->lo) {
+			memmove(q->nodes, q->nodes + q->lo,
+				(q->hi - q->lo) * sizeof(bbnode));
+			q->hi -= q->lo;
+			q->lo = 0;
+		} else {
+			size = (q->size) ? q->size * 2 : 64;
+			q->nodes = tagrealloc(MEM_OTHER, q->nodes,
+				q->size * sizeof(bbnode), size * sizeof(bbnode));
+			q->size = size;
+		}
+	}
+
+	q->nodes[q->hi++] = *nd;
+	pthread_mutex_eunlock(&q->lock);
+}
+
+/**
+ * Takes a candidate from a deque.
+ *
+ * @param q Deque to take the candidate from.
+ * @param nd Pointer to store the candidate at.
+ * @param top Whether the candidate is taken from the top.
+ * @returns Non-zero if a candidate was taken.
+ */
+static int
+takenode(bbdeque *q, bbnode *nd, int top)
+{
+	int found;
+
+	pthread_mutex_elock(&q->lock);
+	if ((found = q->hi > q->lo)) {
+		*nd = (top) ? q->nodes[--q->hi] : q->nodes[q->lo++];
+		if (q->lo == q->hi)
+			q->lo = q->hi = 0;
+	}
+	pthread_mutex_eunlock(&q->lock);
+
+	return found;
+}
+
+/**
+ * Retrieves the next candidate for a worker. Candidates of the worker
+ * itself are preferred, otherwise a candidate is stolen from another
+ * worker. Waits for candidates as long as others are still pending.
+ *
+ * @param w Worker which needs a candidate.
+ * @param nd Pointer to store the candidate at.
+ * @returns Non-zero if a candidate was retrieved, zero if all
+ * 	candidates were processed.
+ */
+static int
+getnode(bbworker *w, bbnode *nd)
+{
+	int found;
+	unsigned int i;
+
+	if (takenode(&deques[w->id], nd, 1))
+		return 1;
+
+	pthread_mutex_elock(&poollock);
+	for (found = 0; !found && pending;) {
+		for (i = 1; !found && i <= nworkers; i++)
+			found = takenode(&deques[(w->id + i) % nworkers], nd, 0);
+		if (found)
+			break;
+
+		nidle++;
+		if ((errno = pthread_cond_wait(&poolcond, &poollock)))
+			die("pthread_cond_wait failed");
+		nidle--;
+	}
+	pthread_mutex_eunlock(&poollock);
+
+	return found;
+}
+
+/**
+ * Pushes all extensions of a candidate with the given undefined
+ * transition. The halting extension isn't pushed but recorded as a
+ * champion right away since it halts with the next step.
+ *
+ * @param w Worker which simulated the candidate.
+ * @param nd Candidate which should be extended.
+ * @param s Index of the state of the undefined transition.
+ * @param c Symbol of the undefined transition.
+ * @returns Amount of pushed candidates.
+ */
+static uint64_t
+extend(bbworker *w, bbnode *nd, unsigned int s, unsigned int c)
+{
+	unsigned int next, sym, dir, maxnext, maxsym, ndirs;
+	unsigned long sigma;
+	uint64_t pushed;
+	bbnode child;
+
+	/* The halting transition writes a 1 and moves right. */
+	child = *nd;
+	child.next[s][c] = BBHALT;
+	child.wsym[s][c] = 1;
+	child.dir[s][c] = RIGHT;
+	child.ndefined++;
+	sigma = countsyms(w->tm->tape) + !c;
+	addchampion(w->best, &child, w->tm->steps + 1, sigma);
+	w->halted++;
+
+	/* Without an undefined transition left the machine can't halt. */
+	if (nd->ndefined + 1u == nstates * nsyms)
+		return 0;
+
+	maxnext = (nd->maxstate + 1u < nstates) ? nd->maxstate + 1u : nstates;
+	maxsym = (nd->maxsym + 1u < nsyms - 1) ? nd->maxsym + 1u : nsyms - 1;
+	ndirs = (nd->ndefined) ? 2 : 1;
+
+	pushed = 0;
+	for (next = 1; next <= maxnext; next++) {
+		for (sym = 0; sym <= maxsym; sym++) {
+			for (dir = 0; dir < ndirs; dir++) {
+				child = *nd;
+				child.next[s][c] = (signed char)next;
+				child.wsym[s][c] = (unsigned char)sym;
+				child.dir[s][c] = (unsigned char)((dir) ? LEFT : RIGHT);
+				child.ndefined++;
+				if (next > child.maxstate)
+					child.maxstate = (unsigned char)next;
+				if (sym > child.maxsym)
+					child.maxsym = (unsigned char)sym;
+
+				pushnode(&deques[w->id], &child);
+				pushed++;
+			}
+		}
+	}
+
+	return pushed;
+}
+
+/**
+ * Simulates a candidate on the blank tape using the interpreter until
+ * it reaches an undefined transition, a decider proves that it never
+ * halts or the step limit is reached.
+ *
+ * The cycler saves the configuration after 2^i steps and checks whether
+ * a later configuration equals it. The translated cycler saves the
+ * configuration whenever the head reaches a new cell for the 2^i-th
+ * time on one side of the tape. A later record on the same side in the
+ * same state proves that the machine never halts if the cells between
+ * the record and the furthest position the head went back to since the
+ * saved record are equal.
+ *
+ * @param w Worker simulating the candidate.
+ * @param s Pointer to store the state of the undefined transition at.
+ * @param c Pointer to store the symbol of the undefined transition at.
+ * @returns Result of the simulation.
+ */
+static bbres
+simulate(bbworker *w, unsigned int *s, unsigned int *c)
+{
+	int side;
+	tmname state;
+	tmtrans *trans;
+	tmtape *t;
+	long pos, lo, hi, edge[2], back[2];
+	unsigned long save, records[2];
+	snapshot *snap;
+
+	t = w->tm->tape;
+	w->tm->steps = 0;
+	if (t->head > t->hi && readinput(t))
+		extendtape(t);
+
+	state = 1;
+	pos = edge[0] = edge[1] = back[0] = back[1] = 0;
+	records[0] = records[1] = 0;
+	w->edges[0].state = w->edges[1].state = BBHALT;
+	save = 1;
+	savesnap(&w->cycle, t, state, pos);
+
+	while (w->tm->steps < limit) {
+		if (steptm(w->tm, &state, &trans)) {
+			*s = (unsigned int)state - 1;
+			*c = t->codes[(unsigned char)readsym(t)];
+			return BB_EXTEND;
+		}
+		pos += (trans->headdir == LEFT) ? -1 : 1;
+
+		if (w->tm->steps == save) {
+			savesnap(&w->cycle, t, state, pos);
+			save *= 2;
+		} else if (state == w->cycle.state && pos == w->cycle.pos) {
+			snap = &w->cycle;
+			lo = pos - (long)(t->head - t->lo);
+			hi = pos + (long)(t->hi - t->head);
+			if (snap->lo < lo)
+				lo = snap->lo;
+			if (snap->lo + (long)snap->len - 1 > hi)
+				hi = snap->lo + (long)snap->len - 1;
+			if (samecells(snap, t, pos, lo, hi, 0))
+				return BB_CYCLER;
+		}
+
+		if (pos < back[0])
+			back[0] = pos;
+		if (pos > back[1])
+			back[1] = pos;
+		if (pos <= edge[1] && pos >= edge[0])
+			continue;
+
+		/* The head reached a new cell, side 1 is the right one. */
+		side = pos > edge[1];
+		edge[side] = pos;
+		snap = &w->edges[side];
+		if (snap->state == state && ((side && samecells(snap, t, pos,
+				back[0], snap->pos, pos - snap->pos)) ||
+				(!side && samecells(snap, t, pos, snap->pos,
+				back[1], pos - snap->pos))))
+			return BB_TRANSLATED;
+
+		records[side]++;
+		if (!(records[side] & (records[side] - 1))) {
+			savesnap(snap, t, state, pos);
+			back[side ? 0 : 1] = pos;
+		}
+	}
+
+	return BB_HOLDOUT;
+}
+
+/**
+ * Worker thread simulating and extending candidates until all
+ * candidates were processed.
+ *
+ * @param arg Void pointer to the worker.
+ */
+static void *
+bbworkerfn(void *arg)
+{
+	bbworker *w;
+	bbnode nd;
+	bbres res;
+	tmtape *proto;
+	unsigned int s, c;
+	uint64_t pushed;
+
+	w = arg;
+	proto = w->tm->tape;
+	while (getnode(w, &nd)) {
+		loadnode(w, &nd);
+		w->tm->tape = blanktape(proto);
+
+		pushed = 0;
+		res = simulate(w, &s, &c);
+		w->counts[res]++;
+		if (res == BB_EXTEND) {
+			pushed = extend(w, &nd, s, c);
+		} else if (res == BB_HOLDOUT) {
+			pthread_mutex_elock(&outlock);
+			writenode(&nd, out);
+			fputs(" holdout\n", out);
+			pthread_mutex_eunlock(&outlock);
+		}
+
+		freetape(w->tm->tape);
+		w->tm->tape = proto;
+
+		pthread_mutex_elock(&poollock);
+		pending += pushed;
+		pending--;
+		if ((pushed && nidle) || !pending)
+			if ((errno = pthread_cond_broadcast(&poolcond)))
+				die("pthread_cond_broadcast failed");
+		pthread_mutex_eunlock(&poollock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Creates the machine a worker loads candidates into. It consists of
+ * all states without any transitions.
+ *
+ * @returns Machine with the tape alphabet of all symbols.
+ */
+static dtm *
+newbbtm(void)
+{
+	unsigned int i;
+	tmstate *state;
+	dtm *tm;
+
+	tm = newtm();
+	tm->start = 1;
+	addaccept(tm, BBHALT);
+	for (i = 1; i <= nstates; i++) {
+		state = newtmstate();
+		state->name = (tmname)i;
+		if (addstate(tm, state))
+			die("addstate failed");
+	}
+	for (i = 1; i < nsyms; i++)
+		addsym(tm->tape, symchar(i));
+
+	return tm;
+}
+
+/**
+ * Parses a numeric command line argument.
+ *
+ * @param prog Name of this program.
+ * @param arg Argument which should be parsed.
+ * @param min Minimum value.
+ * @param max Maximum value.
+ * @returns Parsed value.
+ */
+static unsigned long
+numarg(char *prog, char *arg, unsigned long min, unsigned long max)
+{
+	char *end;
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(arg, &end, 10);
+	if (errno || *end || !*arg || *arg == '-' || val < min || val > max)
+		usage(prog);
+
+	return val;
+}
+
+/**
+ * The main function invoked when the program is started.
+ *
+ * @param argc Amount of command line parameters.
+ * @param argv Command line parameters.
+ */
+int
+main(int argc, char **argv)
+{
+	int opt, i;
+	unsigned int j;
+	long nprocs;
+	char *path;
+	bbworker *workers;
+	pthread_t *thrs;
+	bbnode root;
+	champion best[2];
+	uint64_t counts[BB_HOLDOUT + 1], halted;
+
+	path = NULL;
+	limit = BBSTEPS;
+	nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+	nworkers = (nprocs > 0) ? (unsigned int)nprocs : 1;
+	while ((opt = getopt(argc, argv, "n:j:o:hv")) != -1) {
+		switch (opt) {
+		case 'n':
+			limit = numarg(argv[0], optarg, 1, ULONG_MAX);
+			break;
+		case 'j':
+			nworkers = (unsigned int)numarg(argv[0], optarg, 1, UINT_MAX);
+			break;
+		case 'o':
+			path = optarg;
+			break;
+		case 'v':
+			fprintf(stderr, "tmsim-"VERSION"\n");
+			return EXIT_FAILURE;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind + 2 != argc)
+		usage(argv[0]);
+	nstates = (unsigned int)numarg(argv[0], argv[optind], 1, BBMAXSTATES);
+	nsyms = (unsigned int)numarg(argv[0], argv[optind + 1], 2, BBMAXSYMS);
+
+	if (!path)
+		out = stdout;
+	else if (!(out = fopen(path, "w")))
+		die("couldn't open output");
+
+	memset(&root, 0, sizeof(root));
+	memset(root.next, BBUNDEF, sizeof(root.next));
+	root.maxstate = 1;
+
+	deques = emalloc(nworkers * sizeof(bbdeque));
+	workers = emalloc(nworkers * sizeof(bbworker));
+	for (j = 0; j < nworkers; j++) {
+		memset(&deques[j], 0, sizeof(bbdeque));
+		if ((errno = pthread_mutex_init(&deques[j].lock, NULL)))
+			die("pthread_mutex_init failed");
+
+		memset(&workers[j], 0, sizeof(bbworker));
+		workers[j].id = j;
+		workers[j].tm = newbbtm();
+	}
+
+	pending = 1;
+	pushnode(&deques[0], &root);
+
+	thrs = emalloc(nworkers * sizeof(pthread_t));
+	for (j = 0; j < nworkers; j++)
+		if ((errno = pthread_create(&thrs[j], NULL, bbworkerfn, &workers[j])))
+			die("pthread_create failed");
+	for (j = 0; j < nworkers; j++)
+		if ((errno = pthread_join(thrs[j], NULL)))
+			die("pthread_join failed");
+
+	memset(counts, 0, sizeof(counts));
+	memset(best, 0, sizeof(best));
+	for (halted = 0, j = 0; j < nworkers; j++) {
+		for (i = 0; i <= BB_HOLDOUT; i++)
+			counts[i] += workers[j].counts[i];
+		halted += workers[j].halted;
+		for (i = 0; i < 2; i++)
+			if (workers[j].best[i].steps)
+				addchampion(best, &workers[j].best[i].node,
+					workers[j].best[i].steps,
+					workers[j].best[i].sigma);
+
+		freetm(workers[j].tm);
+		free(workers[j].cycle.cells);
+		free(workers[j].edges[0].cells);
+		free(workers[j].edges[1].cells);
+		free(deques[j].nodes);
+	}
+
+	for (i = 0; i < 2; i++) {
+		writenode(&best[i].node, out);
+		fprintf(out, " champion %lu %lu\n", best[i].steps, best[i].sigma);
+	}
+	if (fflush(out) || (path && fclose(out)))
+		die("couldn't write output");
+
+	fprintf(stderr, "machines %"PRIu64"\nhalted %"PRIu64"\n"
+		"cycler %"PRIu64"\ntranslated %"PRIu64"\nholdouts %"PRIu64"\n"
+		"steps %lu\nsigma %lu\n",
+		counts[BB_EXTEND] + counts[BB_CYCLER] + counts[BB_TRANSLATED] +
+		counts[BB_HOLDOUT] + halted, halted, counts[BB_CYCLER],
+		counts[BB_TRANSLATED], counts[BB_HOLDOUT], best[0].steps,
+		best[1].sigma);
+
+	free(thrs);
+	free(workers);
+	free(deques);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include "compact.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+enum {
+	/**
+	 * Amount of machines claimed by a thread at once.
+	 */
+	BULKCHUNK = 1 << 10,
+
+	/**
+	 * Default maximum amount of steps performed by a machine.
+	 */
+	BULKSTEPS = 1 << 20,
+};
+
+/**
+ * Result of running a single machine.
+ */
+typedef enum {
+	BULK_ACCEPT,  /**< The machine halted using a halting transition. */
+	BULK_REJECT,  /**< The machine reached an undefined transition. */
+	BULK_TIMEOUT, /**< The step limit was reached. */
+	BULK_INVALID, /**< The line isn't valid compact notation. */
+} bulkres;
+
+/**
+ * Machines read from the input file, one machine per line.
+ */
+static char *buf;
+static size_t nlines;
+static size_t *offs, *lens;
+
+static unsigned char *results; /**< Result of each machine. */
+static unsigned long *steps;   /**< Steps performed by each machine. */
+
+static char *input;          /**< Input written to each tape or NULL. */
+static unsigned long limit;  /**< Maximum amount of steps. */
+
+static size_t next; /**< Index of the next unclaimed machine. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Writes the usage string for this program to stderr and terminates
+ * the program with EXIT_FAILURE.
+ */
+static void
+usage(char *prog)
+{
+	fprintf(stderr, "USAGE: %s %s\n", prog,
+		"[-n steps] [-j threads] [-s] [-h|-v] FILE [INPUT]");
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Thread claiming chunks of machines and running them. Each thread
+ * loads all of its machines into a single reused machine.
+ *
+ * @param arg Unused.
+ */
+static void *
+bulkworker(void *arg)
+{
+	size_t i, end;
+	int exceeded, ret;
+	tmtape *proto;
+	dtm *tm;
+
+	(void)arg;
+
+	tm = newcompact();
+	proto = tm->tape;
+	tm->hook = budgethook;
+	tm->hookarg = &exceeded;
+
+	for (;;) {
+		pthread_mutex_elock(&lock);
+		i = next;
+		next = (i < nlines) ? i + BULKCHUNK : i;
+		pthread_mutex_eunlock(&lock);
+		if (i >= nlines)
+			break;
+
+		end = (i + BULKCHUNK < nlines) ? i + BULKCHUNK : nlines;
+		for (; i < end; i++) {
+			if (loadcompact(tm, buf + offs[i], lens[i])) {
+				results[i] = BULK_INVALID;
+				steps[i] = 0;
+				continue;
+			}
+
+			tm->tape = blanktape(proto);
+			if (input)
+				appendtape(tm->tape, input);
+
+			exceeded = 0;
+			tm->steps = 0;
+			tm->hookat = limit;
+
+			/* Unlike ::runtm at least one transition is
+			 * performed on the blank tape. */
+			ret = resumetm(tm, tm->start);
+			if (exceeded)
+				results[i] = BULK_TIMEOUT;
+			else
+				results[i] = (ret) ? BULK_REJECT : BULK_ACCEPT;
+			steps[i] = tm->steps;
+
+			freetape(tm->tape);
+			tm->tape = proto;
+		}
+	}
+
+	freetm(tm);
+	return NULL;
+}
+
+/**
+ * The main function invoked when the program is started.
+ *
+ * @param argc Amount of command line parameters.
+ * @param argv Command line parameters.
+ */
+int
+main(int argc, char **argv)
+{
+	static char *names[] = {
+		[BULK_ACCEPT] = "accept",
+		[BULK_REJECT] = "reject",
+		[BULK_TIMEOUT] = "timeout",
+		[BULK_INVALID] = "invalid",
+	};
+	int opt, withsteps;
+	size_t i, pos;
+	long nthreads;
+	ssize_t len;
+	char *end;
+	pthread_t *thrs;
+
+	withsteps = 0;
+	limit = BULKSTEPS;
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "n:j:shv")) != -1) {
+		switch (opt) {
+		case 'n':
+			errno = 0;
+			limit = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-' || !limit)
+				usage(argv[0]);
+			break;
+		case 'j':
+			errno = 0;
+			nthreads = strtol(optarg, &end, 10);
+			if (errno || *end || nthreads <= 0)
+				usage(argv[0]);
+			break;
+		case 's':
+			withsteps = 1;
+			break;
+		case 'v':
+			fprintf(stderr, "tmsim-"VERSION"\n");
+			return EXIT_FAILURE;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind >= argc || optind + 2 < argc)
+		usage(argv[0]);
+	if (nthreads <= 0)
+		nthreads = 1;
+
+	if (optind + 1 < argc) {
+		input = argv[optind + 1];
+		if (!verifyinput(input, &pos)) {
+			fprintf(stderr, "Input can only consist of alphanumeric "
+				"characters, invalid character at %zu.\n", pos);
+			return EXIT_FAILURE;
+		}
+	}
+
+	buf = NULL;
+	if ((len = readfile(&buf, argv[optind])) == -1)
+		die("couldn't read machines");
+	nlines = splitlines(buf, (size_t)len, &offs, &lens);
+	results = emalloc(nlines ? nlines : 1);
+	steps = emalloc((nlines ? nlines : 1) * sizeof(unsigned long));
+
+	thrs = emalloc((size_t)nthreads * sizeof(pthread_t));
+	for (i = 0; i < (size_t)nthreads; i++)
+		if ((errno = pthread_create(&thrs[i], NULL, bulkworker, NULL)))
+			die("pthread_create failed");
+	for (i = 0; i < (size_t)nthreads; i++)
+		if ((errno = pthread_join(thrs[i], NULL)))
+			die("pthread_join failed");
+
+	for (i = 0; i < nlines; i++) {
+		fputs(names[results[i]], stdout);
+		if (withsteps && results[i] != BULK_INVALID)
+			printf(" %lu", steps[i]);
+		putchar('\n');
+	}
+	if (fflush(stdout))
+		die("couldn't write results");
+
+	if (len)
+		munmap(buf, (size_t)len);
+	free(thrs);
+	free(offs);
+	free(lens);
+	free(results);
+	free(steps);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,385 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "checkpoint.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Magic bytes identifying a checkpoint file.
+ */
+static const char ckptmagic[8] = "TMSIMCKP";
+
+/**
+ * Header of a checkpoint file. The header is followed by the tape as
+ * written by ::savetape.
+ */
+typedef struct _ckpthdr ckpthdr;
+
+struct _ckpthdr {
+	char magic[sizeof(ckptmagic)]; /**< Always equal to ckptmagic. */
+	uint64_t hash;  /**< Hash of the machine, see ::hashtm. */
+	uint64_t steps; /**< Amount of steps performed so far. */
+	int64_t state;  /**< Name of the current state. */
+};
+
+/**
+ * State of periodic checkpointing, see ::autockpt.
+ */
+typedef struct _ckptctx ckptctx;
+
+struct _ckptctx {
+	char *path;          /**< Path of the checkpoint file. */
+	unsigned long every; /**< Amount of steps between two checkpoints. */
+	pid_t child;         /**< Process writing a checkpoint or -1. */
+};
+
+/**
+ * Mixes the given value into an FNV-1a hash.
+ *
+ * @param h Current hash value.
+ * @param val Value which should be mixed into the hash.
+ * @returns Updated hash value.
+ */
+static uint64_t
+mix(uint64_t h, uint64_t val)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		h ^= (val >> (i * 8)) & 0xff;
+		h *= UINT64_C(1099511628211);
+	}
+
+	return h;
+}
+
+/**
+ * Adds the hash of a transition to the hash pointed to by the given
+ * void pointer. Hashes are summed up since the iteration order of the
+ * transitions is unspecified.
+ *
+ * @param trans Transition which should be hashed.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to the hash.
+ */
+static void
+hashtrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	uint64_t h;
+
+	h = UINT64_C(14695981039346656037);
+	h = mix(h, (uint64_t)state->name);
+	h = mix(h, (unsigned char)trans->rsym);
+	h = mix(h, (unsigned char)trans->wsym);
+	h = mix(h, (uint64_t)trans->headdir);
+	h = mix(h, (uint64_t)trans->nextstate);
+	h = mix(h, trans->steps);
+
+	*(uint64_t *)arg += h;
+}
+
+/**
+ * Adds the hashes of all transitions of a state to the hash pointed
+ * to by the given void pointer.
+ *
+ * @param state State whose transitions should be hashed.
+ * @param arg Void pointer to the hash.
+ */
+static void
+hashstate(tmstate *state, void *arg)
+{
+	eachtrans(state, hashtrans, arg);
+}
+
+/**
+ * Calculates a hash of the given turing machine. A checkpoint can only
+ * be restored for a machine with the same hash, i.e. the same machine
+ * transformed using the same optimizations.
+ *
+ * @param tm Turing machine which should be hashed.
+ * @returns Hash of the turing machine.
+ */
+static uint64_t
+hashtm(dtm *tm)
+{
+	size_t i;
+	uint64_t h;
+
+	h = 0;
+	eachstate(tm, hashstate, &h);
+
+	h = mix(h, (uint64_t)tm->start);
+	for (i = 0; i < tm->acceptsiz; i++)
+		h = mix(h, (uint64_t)tm->accept[i]);
+
+	return h;
+}
+
+/**
+ * Writes a checkpoint of the given turing machine to the given file.
+ * The checkpoint is written to a temporary file first which is renamed
+ * afterwards, the checkpoint file is thus always complete.
+ *
+ * @param tm Turing machine whose state should be written.
+ * @param state Name of the current state of the machine.
+ * @param path Path of the checkpoint file.
+ * @returns 0 on success, -1 on failure and errno is set.
+ */
+int
+writeckpt(dtm *tm, tmname state, char *path)
+{
+	int saved;
+	size_t len;
+	char *tmp;
+	FILE *stream;
+	ckpthdr hdr;
+
+	len = strlen(path);
+	tmp = emalloc(len + sizeof(".tmp"));
+	memcpy(tmp, path, len);
+	memcpy(tmp + len, ".tmp", sizeof(".tmp"));
+
+	if (!(stream = fopen(tmp, "w"))) {
+		free(tmp);
+		return -1;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, ckptmagic, sizeof(ckptmagic));
+	hdr.hash = hashtm(tm);
+	hdr.steps = tm->steps;
+	hdr.state = state;
+
+	if (fwrite(&hdr, sizeof(hdr), 1, stream) != 1 ||
+			savetape(tm->tape, stream) || fflush(stream) ||
+			fsync(fileno(stream))) {
+		saved = errno;
+		fclose(stream);
+		goto err;
+	}
+
+	if (fclose(stream) || rename(tmp, path)) {
+		saved = errno;
+		goto err;
+	}
+
+	free(tmp);
+	return 0;
+
+err:
+	unlink(tmp);
+	free(tmp);
+	errno = saved;
+	return -1;
+}
+
+/**
+ * Calculates the step count at which the next checkpoint is written.
+ *
+ * @param tm Turing machine which is checkpointed.
+ * @param every Amount of steps between two checkpoints.
+ * @returns Step count of the next checkpoint.
+ */
+static unsigned long
+nextckpt(dtm *tm, unsigned long every)
+{
+	return (tm->steps > ULONG_MAX - every) ? ULONG_MAX : tm->steps + every;
+}
+
+/**
+ * Hook invoked by the interpreter for writing periodic checkpoints.
+ * The checkpoint is written by a forked child process, the snapshot of
+ * the machine is thus provided by copy-on-write and the interpreter
+ * continues immediately. If the previous checkpoint is still being
+ * written the current one is skipped. File-backed tapes are shared
+ * with the child and are thus checkpointed synchronously.
+ *
+ * @param tm Turing machine whose state should be written.
+ * @param state Name of the current state of the machine.
+ * @param arg Void pointer to the checkpointing state.
+ * @returns Always 0, the machine continues.
+ */
+static int
+ckpthook(dtm *tm, tmname state, void *arg)
+{
+	pid_t pid;
+	ckptctx *ctx;
+
+	ctx = arg;
+	tm->hookat = nextckpt(tm, ctx->every);
+
+	if (ctx->child != -1) {
+		if (!waitpid(ctx->child, NULL, WNOHANG))
+			return 0;
+		ctx->child = -1;
+	}
+
+	if (tm->tape->fd == -1 && (pid = fork()) != -1) {
+		if (pid) {
+			ctx->child = pid;
+			return 0;
+		}
+
+		if (writeckpt(tm, state, ctx->path)) {
+			perror("couldn't write checkpoint");
+			_exit(EXIT_FAILURE);
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	if (writeckpt(tm, state, ctx->path))
+		die("couldn't write checkpoint");
+
+	return 0;
+}
+
+/**
+ * Enables periodic checkpointing for the given turing machine.
+ *
+ * @param tm Turing machine which should be checkpointed.
+ * @param path Path of the checkpoint file.
+ * @param every Amount of steps between two checkpoints.
+ */
+void
+autockpt(dtm *tm, char *path, unsigned long every)
+{
+	ckptctx *ctx;
+
+	ctx = emalloc(sizeof(ckptctx));
+	ctx->path = path;
+	ctx->every = every;
+	ctx->child = -1;
+
+	tm->hook = ckpthook;
+	tm->hookarg = ctx;
+	tm->hookat = nextckpt(tm, every);
+}
+
+/**
+ * Waits until a checkpoint which is currently being written in the
+ * background has been completely written.
+ *
+ * @param tm Turing machine for which ::autockpt was invoked.
+ */
+void
+waitckpt(dtm *tm)
+{
+	ckptctx *ctx;
+
+	if (tm->hook != ckpthook)
+		return;
+
+	ctx = tm->hookarg;
+	if (ctx->child != -1) {
+		while (waitpid(ctx->child, NULL, 0) == -1 && errno == EINTR)
+			;
+		ctx->child = -1;
+	}
+}
+
+/**
+ * Restores a checkpoint written by ::writeckpt. The turing machine
+ * must have been parsed and transformed in the same way as the one
+ * the checkpoint was written for.
+ *
+ * @param tm Turing machine which should be restored.
+ * @param stream Stream to read the checkpoint from.
+ * @param input Stream containing the input the checkpointed machine
+ * 	was started with or NULL if the input was supplied as argument.
+ * @param state Pointer to memory area where the name of the state the
+ * 	machine should continue in is stored.
+ * @returns CKPT_OK on success, an error code otherwise.
+ */
+ckpterr
+readckpt(dtm *tm, FILE *stream, FILE *input, tmname *state)
+{
+	int pending;
+	size_t inpos;
+	ckpthdr hdr;
+
+	if (fread(&hdr, sizeof(hdr), 1, stream) != 1 ||
+			memcmp(hdr.magic, ckptmagic, sizeof(ckptmagic)) ||
+			hdr.state < INT_MIN || hdr.state > INT_MAX ||
+			hdr.steps > ULONG_MAX)
+		return CKPT_MALFORMED;
+	if (hdr.hash != hashtm(tm))
+		return CKPT_MISMATCH;
+	if (restoretape(tm->tape, stream, &pending))
+		return CKPT_MALFORMED;
+
+	if (pending) {
+		if (!input)
+			return CKPT_INPUT;
+
+		inpos = tm->tape->inpos;
+		inputtape(tm->tape, input);
+		if (skipinput(tm->tape, inpos))
+			return CKPT_INPUT;
+	}
+
+	tm->steps = (unsigned long)hdr.steps;
+	*state = (tmname)hdr.state;
+
+	return CKPT_OK;
+}
+
+/**
+ * Formats a ckpterr as a string and writes it to the given stream.
+ *
+ * @param err Error returned by ::readckpt.
+ * @param fn Name of the checkpoint file.
+ * @param stream Stream to write error message to.
+ * @return Number of characters written to the stream.
+ */
+int
+strckpterr(ckpterr err, char *fn, FILE *stream)
+{
+	char *msg;
+
+	switch (err) {
+	case CKPT_MALFORMED:
+		msg = "Malformed checkpoint.";
+		break;
+	case CKPT_MISMATCH:
+		msg = "Checkpoint was written for a different machine "
+			"or different optimizations.";
+		break;
+	case CKPT_INPUT:
+		msg = "Input the checkpoint was written for is missing "
+			"or too short.";
+		break;
+	default:
+		msg = "Unknown error.";
+		break;
+	}
+
+	return fprintf(stream, "%s: %s\n", fn, msg);
+}
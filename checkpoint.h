@@ -0,0 +1,49 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_CHECKPOINT_H
+#define TMSIM_CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Default amount of steps between two checkpoints.
+	 */
+	CKPTSTEPS = 100000000,
+};
+
+/**
+ * Errors which can occur while restoring a checkpoint.
+ */
+typedef enum {
+	CKPT_OK,        /**< Checkpoint was restored successfully. */
+	CKPT_MALFORMED, /**< Checkpoint file is malformed. */
+	CKPT_MISMATCH,  /**< Checkpoint was created for a different machine. */
+	CKPT_INPUT,     /**< Input required to continue is missing. */
+} ckpterr;
+
+int writeckpt(dtm *, tmname, char *);
+void autockpt(dtm *, char *, unsigned long);
+void waitckpt(dtm *);
+ckpterr readckpt(dtm *, FILE *, FILE *, tmname *);
+int strckpterr(ckpterr, char *, FILE *);
+
+#endif
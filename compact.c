@@ -0,0 +1,171 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#include "compact.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * The compact notation describes a machine on a single line, e.g.
+ * 1RB1LC_1RC1RB_1RD0LE_1LA1LD_1RZ0LA. Each state is a group of
+ * transitions separated by underscores, one transition per symbol.
+ * A transition consists of the written symbol, the direction and the
+ * next state. Undefined transitions are written as ---, a transition
+ * to a state beyond the last one halts.
+ *
+ * State A is loaded as q1, B as q2 and so on. Halting transitions
+ * switch to q0, the only accepting state, the machine thus accepts if
+ * it halts using such a transition and rejects if it halts on an
+ * undefined transition. Symbol 0 is the blank symbol, all other
+ * symbols are represented by their digit.
+ */
+
+/**
+ * Returns the tape symbol of the given digit.
+ *
+ * @param digit Digit of the symbol in compact notation.
+ * @returns Tape symbol.
+ */
+static char
+digitsym(char digit)
+{
+	return (digit == '0') ? BLANKCHAR : digit;
+}
+
+/**
+ * Creates an empty machine compact notation can be loaded into.
+ *
+ * @returns Pointer to the machine, q1 is the initial state.
+ */
+dtm *
+newcompact(void)
+{
+	dtm *tm;
+
+	tm = newtm();
+	tm->start = 1;
+	addaccept(tm, 0);
+	return tm;
+}
+
+/**
+ * Checks the given compact notation and determines its dimensions.
+ *
+ * @param str Compact notation, not necessarily terminated.
+ * @param len Length of the notation.
+ * @param nstates Pointer to store the amount of states at.
+ * @param nsyms Pointer to store the amount of symbols at.
+ * @returns 0 if the notation is valid, -1 otherwise.
+ */
+static int
+checkcompact(char *str, size_t len, size_t *nstates, size_t *nsyms)
+{
+	size_t i, k, n;
+	char *t;
+
+	for (k = 0; k < len && str[k] != '_'; k++)
+		;
+	if (k % 3 || k / 3 < 2 || k / 3 > COMPACTMAXSYMS || (len + 1) % (k + 1))
+		return -1;
+	if ((n = (len + 1) / (k + 1)) > COMPACTMAXSTATES)
+		return -1;
+
+	for (i = 0; i < len; i += 3) {
+		if (i % (k + 1) == k && str[i++] != '_')
+			return -1;
+
+		t = &str[i];
+		if (t[0] == '-' && t[1] == '-' && t[2] == '-')
+			continue;
+		if (t[0] < '0' || (size_t)(t[0] - '0') >= k / 3 ||
+				(t[1] != 'L' && t[1] != 'R') ||
+				t[2] < 'A' || t[2] > 'Z')
+			return -1;
+	}
+
+	*nstates = n;
+	*nsyms = k / 3;
+	return 0;
+}
+
+/**
+ * Loads a machine in compact notation into the given machine created
+ * using ::newcompact. States and transitions already present in the
+ * machine are reused, loading many machines of the same size into a
+ * single machine thus doesn't allocate any memory.
+ *
+ * @param tm Machine the notation should be loaded into.
+ * @param str Compact notation, not necessarily terminated.
+ * @param len Length of the notation.
+ * @returns 0 on success, -1 if the notation is invalid. The machine is
+ * 	left unmodified in the latter case.
+ */
+int
+loadcompact(dtm *tm, char *str, size_t len)
+{
+	size_t s, c, nstates, nsyms;
+	tmname name;
+	tmstate *state;
+	tmtrans *trans;
+	char *t;
+
+	if (checkcompact(str, len, &nstates, &nsyms))
+		return -1;
+
+	for (c = 1; c < nsyms; c++)
+		addsym(tm->tape, (char)('0' + c));
+	for (name = (tmname)nstates + 1; !getstate(tm, name, &state); name++)
+		delstate(tm, name);
+
+	for (s = 0; s < nstates; s++) {
+		if (getstate(tm, (tmname)s + 1, &state)) {
+			state = newtmstate();
+			state->name = (tmname)s + 1;
+			(void)addstate(tm, state);
+		}
+
+		for (c = 0; c < nsyms; c++) {
+			t = &str[s * (3 * nsyms + 1) + 3 * c];
+			if (t[0] == '-') {
+				(void)deltrans(state, digitsym((char)('0' + c)));
+				continue;
+			}
+
+			if (gettrans(state, digitsym((char)('0' + c)), &trans)) {
+				trans = newtrans();
+				trans->rsym = digitsym((char)('0' + c));
+				(void)addtrans(state, trans);
+			}
+
+			trans->wsym = digitsym(t[0]);
+			trans->headdir = (t[1] == 'L') ? LEFT : RIGHT;
+			trans->nextstate = ((size_t)(t[2] - 'A') < nstates) ?
+				t[2] - 'A' + 1 : 0;
+		}
+
+		/* Left over from a previously loaded machine with more
+		 * symbols, the tape alphabet still contains them. */
+		for (c = nsyms; c < COMPACTMAXSYMS; c++)
+			(void)deltrans(state, digitsym((char)('0' + c)));
+	}
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_COMPACT_H
+#define TMSIM_COMPACT_H
+
+#include <stddef.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Maximum amount of states of a machine in compact notation. The
+	 * states are named A to Y, Z denotes the halting state.
+	 */
+	COMPACTMAXSTATES = 25,
+
+	/**
+	 * Maximum amount of symbols of a machine in compact notation.
+	 */
+	COMPACTMAXSYMS = 10,
+};
+
+dtm *newcompact(void);
+int loadcompact(dtm *, char *, size_t);
+
+#endif
@@ -0,0 +1,913 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include "parser.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * The daemon answers simulation requests send over a Unix domain
+ * socket. Each message is prefixed with its length as a 32 bit
+ * unsigned integer, all integers are encoded in network byte order.
+ *
+ * A request consists of a 32 bit request identifier, a flags byte, a
+ * 64 bit step budget (0 for unlimited), the 16 bit length of the
+ * machine name, the machine name and the input. The budget is only
+ * exhausted if a further step would exceed it, a machine halting after
+ * exactly budget steps is answered normally. A response consists of
+ * the identifier of the request, a status byte, the amount of steps
+ * performed as a 64 bit integer and, if requested, the tape content.
+ *
+ * Requests of a connection are processed concurrently, responses are
+ * thus not necessarily send in request order.
+ */
+enum {
+	REQ_TAPE = 1 << 0, /**< Flag requesting the tape in the response. */
+
+	REQHDRSIZ = 4 + 1 + 8 + 2, /**< Size of the fixed request fields. */
+	RESHDRSIZ = 4 + 1 + 8,     /**< Size of the fixed response fields. */
+
+	/**
+	 * Maximum length of a request, longer ones close the connection.
+	 */
+	MAXREQUEST = 1 << 24,
+
+	/**
+	 * Maximum amount of queued requests. Connections stop being read
+	 * while the queue is full.
+	 */
+	MAXJOBS = 1024,
+
+	/**
+	 * Maximum amount of requests of a connection whose responses
+	 * weren't send yet. The connection stops being read while this
+	 * amount is reached, e.g. if the client doesn't read responses.
+	 */
+	MAXPENDING = 64,
+};
+
+/**
+ * Status of a simulation request.
+ */
+typedef enum {
+	RES_ACCEPT,  /**< The machine accepted the input. */
+	RES_REJECT,  /**< The machine rejected the input. */
+	RES_BUDGET,  /**< The step budget was exhausted. */
+	RES_UNKNOWN, /**< No machine with the requested name is loaded. */
+	RES_INPUT,   /**< The input contained an invalid symbol. */
+} result;
+
+/**
+ * Parsed turing machine shared by all runs using it. A machine is
+ * freed as soon as it was replaced by a reload and all runs using it
+ * have finished.
+ */
+typedef struct _machine machine;
+
+struct _machine {
+	dtm *tm;     /**< Parsed turing machine, never modified. */
+	size_t refs; /**< Amount of references, protected by reglock. */
+};
+
+/**
+ * Named machine file loaded by the daemon.
+ */
+typedef struct _slot slot;
+
+struct _slot {
+	char *name;  /**< Name used in requests. */
+	char *path;  /**< Path of the machine file. */
+	machine *cur; /**< Currently loaded version of the machine. */
+};
+
+/**
+ * Encoded response waiting to be send by the writer of a connection.
+ */
+typedef struct _resp resp;
+
+struct _resp {
+	unsigned char *buf; /**< Response including the length prefix. */
+	size_t len;         /**< Length of the response. */
+	resp *next;         /**< Next response of the connection. */
+};
+
+/**
+ * Client connection. Each connection has a reader and a writer thread,
+ * worker threads only queue responses and thus never block on a
+ * client. The connection is closed as soon as the client stopped
+ * sending requests and all responses have been send.
+ */
+typedef struct _conn conn;
+
+struct _conn {
+	int fd;                 /**< Socket of the connection. */
+	size_t refs;            /**< Reader and writer. */
+	int reading;            /**< Whether requests are still read. */
+	size_t pending;         /**< Requests whose response wasn't send. */
+	resp *head, *tail;      /**< Queued responses. */
+	pthread_mutex_t lock;   /**< Protects all fields except fd. */
+	pthread_cond_t ready;   /**< Signaled if the writer has work. */
+	pthread_cond_t space;   /**< Signaled if pending decreased. */
+};
+
+/**
+ * Queued simulation request.
+ */
+typedef struct _job job;
+
+struct _job {
+	conn *c;              /**< Connection the request was received on. */
+	uint32_t id;          /**< Identifier chosen by the client. */
+	int flags;            /**< Request flags, see ::REQ_TAPE. */
+	unsigned long budget; /**< Maximum amount of steps or 0. */
+	char *name;           /**< Name of the machine. */
+	char *input;          /**< Input for the machine. */
+	job *next;            /**< Next job in the queue. */
+};
+
+/**
+ * Loaded machines, the pointers to the current version of each machine
+ * are protected by reglock.
+ */
+static slot *slots;
+static size_t nslots;
+static pthread_mutex_t reglock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Queue of pending jobs processed by the worker threads.
+ */
+static job *jobhead, *jobtail;
+static size_t njobs;
+static pthread_mutex_t joblock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobavail = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobspace = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Path of the socket, removed on termination.
+ */
+static char *sockpath;
+
+/**
+ * Writes the usage string for this program to stderr and terminates
+ * the program with EXIT_FAILURE.
+ */
+static void
+usage(char *prog)
+{
+	fprintf(stderr, "USAGE: %s %s\n", prog,
+		"[-j threads] [-h|-v] SOCKET FILE...");
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Stores the given value as a big endian integer of the given size.
+ *
+ * @param buf Buffer the integer should be stored in.
+ * @param val Value which should be stored.
+ * @param len Size of the integer in bytes.
+ */
+static void
+putbe(unsigned char *buf, uint64_t val, size_t len)
+{
+	while (len--) {
+		buf[len] = (unsigned char)(val & 0xff);
+		val >>= 8;
+	}
+}
+
+/**
+ * Loads a big endian integer of the given size.
+ *
+ * @param buf Buffer the integer is stored in.
+ * @param len Size of the integer in bytes.
+ * @returns Value of the integer.
+ */
+static uint64_t
+getbe(unsigned char *buf, size_t len)
+{
+	size_t i;
+	uint64_t val;
+
+	for (val = 0, i = 0; i < len; i++)
+		val = (val << 8) | buf[i];
+	return val;
+}
+
+/**
+ * Reads exactly the given amount of bytes from a socket.
+ *
+ * @param fd Socket to read from.
+ * @param buf Buffer to read into.
+ * @param len Amount of bytes to read.
+ * @returns 0 on success, -1 on error or end of file.
+ */
+static int
+readall(int fd, unsigned char *buf, size_t len)
+{
+	ssize_t r;
+
+	while (len) {
+		if ((r = read(fd, buf, len)) == -1 && errno == EINTR)
+			continue;
+		else if (r <= 0)
+			return -1;
+		buf += r;
+		len -= (size_t)r;
+	}
+
+	return 0;
+}
+
+/**
+ * Writes exactly the given amount of bytes to a socket.
+ *
+ * @param fd Socket to write to.
+ * @param buf Buffer to write.
+ * @param len Amount of bytes to write.
+ * @returns 0 on success, -1 on error.
+ */
+static int
+writeall(int fd, unsigned char *buf, size_t len)
+{
+	ssize_t r;
+
+	while (len) {
+		if ((r = write(fd, buf, len)) == -1 && errno == EINTR)
+			continue;
+		else if (r == -1)
+			return -1;
+		buf += r;
+		len -= (size_t)r;
+	}
+
+	return 0;
+}
+
+/**
+ * Parses the given machine file.
+ *
+ * @param path Path of the machine file.
+ * @returns Parsed machine or NULL if the file couldn't be read or
+ * 	parsed. An error message is written to stderr in that case.
+ */
+static machine *
+loadmachine(char *path)
+{
+	machine *m;
+	dtm *tm;
+
+	if (!(tm = loadtm(path)))
+		return NULL;
+
+	m = emalloc(sizeof(machine));
+	m->tm = tm;
+	m->refs = 1;
+	return m;
+}
+
+/**
+ * Drops a reference to the given machine and frees it if it was the
+ * last one.
+ *
+ * @pre reglock must be held.
+ * @param m Machine whose reference should be dropped.
+ */
+static void
+dropmachine(machine *m)
+{
+	if (--m->refs)
+		return;
+
+	freetm(m->tm);
+	free(m);
+}
+
+/**
+ * Looks up the current version of the machine with the given name and
+ * acquires a reference to it.
+ *
+ * @param name Name of the machine.
+ * @returns Machine or NULL if there is no machine with this name.
+ */
+static machine *
+getmachine(char *name)
+{
+	size_t i;
+	machine *m;
+
+	m = NULL;
+	pthread_mutex_elock(&reglock);
+	for (i = 0; i < nslots; i++) {
+		if (!strcmp(slots[i].name, name)) {
+			m = slots[i].cur;
+			m->refs++;
+			break;
+		}
+	}
+	pthread_mutex_eunlock(&reglock);
+
+	return m;
+}
+
+/**
+ * Drops a reference acquired using ::getmachine.
+ *
+ * @param m Machine whose reference should be dropped.
+ */
+static void
+putmachine(machine *m)
+{
+	pthread_mutex_elock(&reglock);
+	dropmachine(m);
+	pthread_mutex_eunlock(&reglock);
+}
+
+/**
+ * Parses all machine files again and replaces the loaded machines.
+ * Runs which are in progress continue using the previous version. If a
+ * file can't be parsed the previous version is kept.
+ */
+static void
+reload(void)
+{
+	size_t i;
+	machine *m;
+
+	for (i = 0; i < nslots; i++) {
+		if (!(m = loadmachine(slots[i].path)))
+			continue;
+
+		pthread_mutex_elock(&reglock);
+		dropmachine(slots[i].cur);
+		slots[i].cur = m;
+		pthread_mutex_eunlock(&reglock);
+	}
+}
+
+/**
+ * Drops a reference to the given connection and closes it if it was
+ * the last one.
+ *
+ * @param c Connection whose reference should be dropped.
+ */
+static void
+putconn(conn *c)
+{
+	size_t refs;
+
+	pthread_mutex_elock(&c->lock);
+	refs = --c->refs;
+	pthread_mutex_eunlock(&c->lock);
+	if (refs)
+		return;
+
+	close(c->fd);
+	if ((errno = pthread_mutex_destroy(&c->lock)))
+		die("pthread_mutex_destroy failed");
+	if ((errno = pthread_cond_destroy(&c->ready)) ||
+			(errno = pthread_cond_destroy(&c->space)))
+		die("pthread_cond_destroy failed");
+	free(c);
+}
+
+/**
+ * Adds a job to the queue, waits while the queue is full.
+ *
+ * @param j Job which should be added.
+ */
+static void
+pushjob(job *j)
+{
+	pthread_mutex_elock(&joblock);
+	while (njobs >= MAXJOBS)
+		if ((errno = pthread_cond_wait(&jobspace, &joblock)))
+			die("pthread_cond_wait failed");
+
+	j->next = NULL;
+	if (jobtail)
+		jobtail->next = j;
+	else
+		jobhead = j;
+	jobtail = j;
+	njobs++;
+
+	if ((errno = pthread_cond_signal(&jobavail)))
+		die("pthread_cond_signal failed");
+	pthread_mutex_eunlock(&joblock);
+}
+
+/**
+ * Removes the least recently added job from the queue, waits while the
+ * queue is empty.
+ *
+ * @returns Removed job.
+ */
+static job *
+popjob(void)
+{
+	job *j;
+
+	pthread_mutex_elock(&joblock);
+	while (!jobhead)
+		if ((errno = pthread_cond_wait(&jobavail, &joblock)))
+			die("pthread_cond_wait failed");
+
+	j = jobhead;
+	if (!(jobhead = j->next))
+		jobtail = NULL;
+	njobs--;
+
+	if ((errno = pthread_cond_signal(&jobspace)))
+		die("pthread_cond_signal failed");
+	pthread_mutex_eunlock(&joblock);
+
+	return j;
+}
+
+/**
+ * Runs the given machine on the input of the given job. The states of
+ * the machine are shared, each run uses its own tape.
+ *
+ * @param m Machine which should be run.
+ * @param j Job whose input should be used.
+ * @param tape Pointer to store the tape content at if requested by the
+ * 	job. The content is allocated using open_memstream(3).
+ * @param len Pointer to store the length of the tape content at.
+ * @param steps Pointer to store the amount of performed steps at.
+ * @returns Result of the run.
+ */
+static result
+runjob(machine *m, job *j, char **tape, size_t *len, unsigned long *steps)
+{
+	size_t pos;
+	int exceeded, ret;
+	dtm run;
+	FILE *stream;
+
+	if (!verifyinput(j->input, &pos))
+		return RES_INPUT;
+
+	run = *m->tm;
+	run.tape = blanktape(m->tm->tape);
+	appendtape(run.tape, j->input);
+
+	exceeded = 0;
+	run.profile = 0;
+	run.steps = 0;
+	run.hook = budgethook;
+	run.hookarg = &exceeded;
+	run.hookat = (j->budget) ? j->budget : ULONG_MAX;
+
+	ret = runtm(&run);
+	*steps = run.steps;
+
+	if (j->flags & REQ_TAPE) {
+		if (!(stream = open_memstream(tape, len)))
+			die("open_memstream failed");
+		printcells(run.tape, stream);
+		if (fclose(stream))
+			die("couldn't write tape");
+	}
+
+	freetape(run.tape);
+	if (exceeded)
+		return RES_BUDGET;
+	return (ret) ? RES_REJECT : RES_ACCEPT;
+}
+
+/**
+ * Queues the response for a job, it is send by the writer of the
+ * connection.
+ *
+ * @param j Job which was processed.
+ * @param res Result of the job.
+ * @param steps Amount of steps performed.
+ * @param tape Tape content or NULL.
+ * @param len Length of the tape content.
+ */
+static void
+respond(job *j, result res, unsigned long steps, char *tape, size_t len)
+{
+	conn *c;
+	resp *r;
+
+	r = emalloc(sizeof(resp));
+	r->len = 4 + RESHDRSIZ + len;
+	r->buf = emalloc(r->len);
+	r->next = NULL;
+
+	putbe(r->buf, RESHDRSIZ + len, 4);
+	putbe(r->buf + 4, j->id, 4);
+	r->buf[8] = (unsigned char)res;
+	putbe(r->buf + 9, steps, 8);
+	if (len)
+		memcpy(r->buf + 4 + RESHDRSIZ, tape, len);
+
+	c = j->c;
+	pthread_mutex_elock(&c->lock);
+	if (c->tail)
+		c->tail->next = r;
+	else
+		c->head = r;
+	c->tail = r;
+
+	if ((errno = pthread_cond_signal(&c->ready)))
+		die("pthread_cond_signal failed");
+	pthread_mutex_eunlock(&c->lock);
+}
+
+/**
+ * Worker thread processing queued jobs.
+ *
+ * @param arg Unused.
+ */
+static void *
+worker(void *arg)
+{
+	job *j;
+	machine *m;
+	result res;
+	char *tape;
+	size_t len;
+	unsigned long steps;
+
+	(void)arg;
+
+	for (;;) {
+		j = popjob();
+		tape = NULL;
+		len = steps = 0;
+
+		if (!(m = getmachine(j->name))) {
+			res = RES_UNKNOWN;
+		} else {
+			res = runjob(m, j, &tape, &len, &steps);
+			putmachine(m);
+		}
+
+		respond(j, res, steps, tape, len);
+		free(tape);
+		free(j->name);
+		free(j);
+	}
+
+	return NULL;
+}
+
+/**
+ * Parses a request and creates a job for it.
+ *
+ * @param c Connection the request was received on.
+ * @param buf Request without the length prefix.
+ * @param len Length of the request.
+ * @returns Job or NULL if the request is malformed.
+ */
+static job *
+newjob(conn *c, unsigned char *buf, size_t len)
+{
+	job *j;
+	size_t nlen;
+	uint64_t budget;
+
+	if (len < REQHDRSIZ)
+		return NULL;
+	nlen = (size_t)getbe(buf + 13, 2);
+	if (nlen > len - REQHDRSIZ)
+		return NULL;
+	budget = getbe(buf + 5, 8);
+
+	j = emalloc(sizeof(job));
+	j->c = c;
+	j->id = (uint32_t)getbe(buf, 4);
+	j->flags = buf[4];
+	j->budget = (budget > ULONG_MAX) ? ULONG_MAX : (unsigned long)budget;
+
+	/* Name and input are stored in a single allocation. */
+	j->name = emalloc(len - REQHDRSIZ + 2);
+	memcpy(j->name, buf + REQHDRSIZ, nlen);
+	j->name[nlen] = '\0';
+	j->input = j->name + nlen + 1;
+	memcpy(j->input, buf + REQHDRSIZ + nlen, len - REQHDRSIZ - nlen);
+	j->input[len - REQHDRSIZ - nlen] = '\0';
+
+	return j;
+}
+
+/**
+ * Thread reading the requests of a connection and queueing them.
+ * Multiple requests can be send without waiting for responses.
+ *
+ * @param arg Void pointer to the connection.
+ */
+static void *
+reader(void *arg)
+{
+	conn *c;
+	job *j;
+	size_t len;
+	unsigned char hdr[4], *buf;
+
+	c = arg;
+	buf = NULL;
+
+	while (!readall(c->fd, hdr, sizeof(hdr))) {
+		if ((len = (size_t)getbe(hdr, 4)) > MAXREQUEST)
+			break;
+
+		buf = erealloc(buf, len ? len : 1);
+		if (readall(c->fd, buf, len) || !(j = newjob(c, buf, len)))
+			break;
+
+		pthread_mutex_elock(&c->lock);
+		while (c->pending >= MAXPENDING)
+			if ((errno = pthread_cond_wait(&c->space, &c->lock)))
+				die("pthread_cond_wait failed");
+		c->pending++;
+		pthread_mutex_eunlock(&c->lock);
+		pushjob(j);
+	}
+
+	/* Stop reading, pending responses are still send. */
+	shutdown(c->fd, SHUT_RD);
+	free(buf);
+
+	pthread_mutex_elock(&c->lock);
+	c->reading = 0;
+	if ((errno = pthread_cond_signal(&c->ready)))
+		die("pthread_cond_signal failed");
+	pthread_mutex_eunlock(&c->lock);
+	putconn(c);
+
+	return NULL;
+}
+
+/**
+ * Thread sending the queued responses of a connection. Once a write
+ * failed the remaining responses are discarded, the client notices the
+ * closed connection.
+ *
+ * @param arg Void pointer to the connection.
+ */
+static void *
+writer(void *arg)
+{
+	conn *c;
+	resp *r;
+	int failed;
+
+	c = arg;
+	failed = 0;
+
+	pthread_mutex_elock(&c->lock);
+	for (;;) {
+		while (!c->head && (c->reading || c->pending))
+			if ((errno = pthread_cond_wait(&c->ready, &c->lock)))
+				die("pthread_cond_wait failed");
+		if (!(r = c->head))
+			break;
+		if (!(c->head = r->next))
+			c->tail = NULL;
+		pthread_mutex_eunlock(&c->lock);
+
+		if (!failed && writeall(c->fd, r->buf, r->len))
+			failed = 1;
+		free(r->buf);
+		free(r);
+
+		pthread_mutex_elock(&c->lock);
+		c->pending--;
+		if ((errno = pthread_cond_signal(&c->space)))
+			die("pthread_cond_signal failed");
+	}
+	pthread_mutex_eunlock(&c->lock);
+	putconn(c);
+
+	return NULL;
+}
+
+/**
+ * Thread handling signals. SIGHUP reloads all machines, SIGINT and
+ * SIGTERM remove the socket and terminate the daemon.
+ *
+ * @param arg Void pointer to the set of handled signals.
+ */
+static void *
+sighandler(void *arg)
+{
+	int sig;
+
+	for (;;) {
+		if ((errno = sigwait(arg, &sig)))
+			die("sigwait failed");
+
+		if (sig == SIGHUP) {
+			reload();
+			continue;
+		}
+
+		unlink(sockpath);
+		exit(EXIT_SUCCESS);
+	}
+
+	return NULL;
+}
+
+/**
+ * Creates a thread which isn't joined.
+ *
+ * @param fn Function executed by the thread.
+ * @param arg Argument passed to the function.
+ */
+static void
+spawn(void *(*fn)(void *), void *arg)
+{
+	pthread_t thr;
+
+	if ((errno = pthread_create(&thr, NULL, fn, arg)))
+		die("pthread_create failed");
+	if ((errno = pthread_detach(thr)))
+		die("pthread_detach failed");
+}
+
+/**
+ * Loads the given machine files. The name of each machine is the
+ * file name without directories and without a .tm suffix.
+ *
+ * @param prog Name of this program.
+ * @param paths Paths of the machine files.
+ * @param n Amount of paths.
+ */
+static void
+loadslots(char *prog, char **paths, size_t n)
+{
+	size_t i, j, len;
+	char *name;
+
+	slots = emalloc(n * sizeof(slot));
+	for (i = 0; i < n; i++) {
+		name = strrchr(paths[i], '/');
+		name = estrndup((name) ? name + 1 : paths[i], strlen(paths[i]));
+		len = strlen(name);
+		if (len > 3 && !strcmp(name + len - 3, ".tm"))
+			name[len - 3] = '\0';
+
+		for (j = 0; j < i; j++)
+			if (!strcmp(slots[j].name, name))
+				usage(prog);
+
+		slots[i].name = name;
+		slots[i].path = paths[i];
+		if (!(slots[i].cur = loadmachine(paths[i])))
+			exit(EXIT_FAILURE);
+	}
+
+	nslots = n;
+}
+
+/**
+ * Creates the listening socket. A stale socket left at the given path
+ * is replaced.
+ *
+ * @param path Path of the socket.
+ * @returns File descriptor of the socket.
+ */
+static int
+listensock(char *path)
+{
+	int fd;
+	struct stat st;
+	struct sockaddr_un addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	if (!stat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+		return -1;
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+			listen(fd, SOMAXCONN))
+		return -1;
+
+	return fd;
+}
+
+/**
+ * The main function invoked when the program is started.
+ *
+ * @param argc Amount of command line parameters.
+ * @param argv Command line parameters.
+ */
+int
+main(int argc, char **argv)
+{
+	int opt, lfd, fd;
+	long nthreads;
+	char *end;
+	conn *c;
+	sigset_t set;
+
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "j:hv")) != -1) {
+		switch (opt) {
+		case 'j':
+			errno = 0;
+			nthreads = strtol(optarg, &end, 10);
+			if (errno || *end || nthreads <= 0)
+				usage(argv[0]);
+			break;
+		case 'v':
+			fprintf(stderr, "tmsim-"VERSION"\n");
+			return EXIT_FAILURE;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc <= 1 || optind + 1 >= argc)
+		usage(argv[0]);
+	if (nthreads <= 0)
+		nthreads = 1;
+
+	sockpath = argv[optind];
+	loadslots(argv[0], &argv[optind + 1], (size_t)(argc - optind - 1));
+
+	/* Signals are only handled by a dedicated thread, all threads
+	 * inherit this mask. Failed writes are reported by write(2). */
+	sigemptyset(&set);
+	sigaddset(&set, SIGHUP);
+	sigaddset(&set, SIGINT);
+	sigaddset(&set, SIGTERM);
+	if ((errno = pthread_sigmask(SIG_BLOCK, &set, NULL)))
+		die("pthread_sigmask failed");
+	signal(SIGPIPE, SIG_IGN);
+
+	if ((lfd = listensock(sockpath)) == -1)
+		die("couldn't create socket");
+
+	spawn(sighandler, &set);
+	while (nthreads--)
+		spawn(worker, NULL);
+
+	for (;;) {
+		if ((fd = accept(lfd, NULL, NULL)) == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			die("accept failed");
+		}
+
+		c = emalloc(sizeof(conn));
+		c->fd = fd;
+		c->refs = 2;
+		c->reading = 1;
+		c->pending = 0;
+		c->head = c->tail = NULL;
+		if ((errno = pthread_mutex_init(&c->lock, NULL)))
+			die("pthread_mutex_init failed");
+		if ((errno = pthread_cond_init(&c->ready, NULL)) ||
+				(errno = pthread_cond_init(&c->space, NULL)))
+			die("pthread_cond_init failed");
+		spawn(reader, c);
+		spawn(writer, c);
+	}
+
+	return EXIT_SUCCESS;
+}
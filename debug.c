@@ -0,0 +1,384 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+
+#include "debug.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Entry of the undo log, contains everything required to revert a
+ * single step of a deterministic turing machine.
+ */
+typedef struct _undo undo;
+
+struct _undo {
+	tmname state;        /**< State before the step was performed. */
+	unsigned char code;  /**< Code of the overwritten cell. */
+	unsigned char dir;   /**< Direction the head was moved in. */
+	unsigned char grown; /**< Whether a new cell was accessed. */
+};
+
+/**
+ * Full snapshot of the turing machine, taken every SNAPSTEPS steps.
+ */
+typedef struct _snapshot snapshot;
+
+struct _snapshot {
+	tmname state; /**< State of the machine. */
+	char *buf;    /**< Tape as written by ::savetape. */
+	size_t len;   /**< Length of the buffer. */
+};
+
+/**
+ * State of an interactive debugging session.
+ */
+typedef struct _debugger debugger;
+
+struct _debugger {
+	dtm *tm;            /**< Turing machine being debugged. */
+	tmname state;       /**< Current state of the machine. */
+	unsigned long base; /**< Step count when the session started. */
+
+	snapshot *snaps; /**< Snapshot of every SNAPSTEPS-th step. */
+	size_t nsnaps;   /**< Amount of snapshots taken so far. */
+
+	/**
+	 * Undo log for all steps performed since the last snapshot.
+	 * Contains at most SNAPSTEPS entries.
+	 */
+	undo *log;
+	size_t nlog; /**< Amount of entries in the undo log. */
+};
+
+/**
+ * Returns the amount of steps performed since the session started.
+ *
+ * @param d Debugging session.
+ * @returns Current step.
+ */
+static unsigned long
+curstep(debugger *d)
+{
+	return d->tm->steps - d->base;
+}
+
+/**
+ * Takes a snapshot of the turing machine and appends it to the list
+ * of snapshots.
+ *
+ * @param d Debugging session.
+ */
+static void
+takesnap(debugger *d)
+{
+	FILE *stream;
+	snapshot *snap;
+
+	d->snaps = tagrealloc(MEM_OTHER, d->snaps,
+		d->nsnaps * sizeof(snapshot), (d->nsnaps + 1) * sizeof(snapshot));
+	snap = &d->snaps[d->nsnaps++];
+	snap->state = d->state;
+
+	if (!(stream = open_memstream(&snap->buf, &snap->len)))
+		die("open_memstream failed");
+	if (savetape(d->tm->tape, stream) || fclose(stream))
+		die("couldn't save tape");
+}
+
+/**
+ * Restores the turing machine from a snapshot and clears the undo log.
+ *
+ * @param d Debugging session.
+ * @param idx Index of the snapshot.
+ */
+static void
+loadsnap(debugger *d, size_t idx)
+{
+	int pending;
+	FILE *stream;
+	snapshot *snap;
+
+	assert(idx < d->nsnaps);
+	snap = &d->snaps[idx];
+
+	if (!(stream = fmemopen(snap->buf, snap->len, "r")))
+		die("fmemopen failed");
+	/* Can't fail, the snapshot was written by savetape. */
+	(void)restoretape(d->tm->tape, stream, &pending);
+	fclose(stream);
+
+	d->tm->steps = d->base + idx * SNAPSTEPS;
+	d->state = snap->state;
+	d->nlog = 0;
+}
+
+/**
+ * Performs a single step and records it in the undo log.
+ *
+ * @param d Debugging session.
+ * @returns 0 if a step was performed, -1 if the machine halted.
+ */
+static int
+forward(debugger *d)
+{
+	size_t len, idx;
+	undo *u;
+	tmtape *t;
+	tmtrans *trans;
+
+	t = d->tm->tape;
+	if (t->head > t->hi)
+		return -1;
+
+	if (!(curstep(d) % SNAPSTEPS)) {
+		idx = curstep(d) / SNAPSTEPS;
+		if (idx == d->nsnaps)
+			takesnap(d);
+		d->nlog = 0;
+	}
+
+	u = &d->log[d->nlog];
+	u->state = d->state;
+	u->code = (unsigned char)getcell(t, t->head);
+
+	len = t->hi - t->lo;
+	if (steptm(d->tm, &d->state, &trans))
+		return -1;
+	assert(trans->steps == 1);
+
+	u->dir = (unsigned char)trans->headdir;
+	u->grown = (t->hi - t->lo) != len;
+	d->nlog++;
+
+	return 0;
+}
+
+/**
+ * Reverts the last step using the undo log. If the undo log is empty
+ * the previous snapshot is restored instead and the machine is moved
+ * forward to the step before the current one.
+ *
+ * @param d Debugging session.
+ * @returns 0 if a step was reverted, -1 if no step was performed yet.
+ */
+static int
+backward(debugger *d)
+{
+	unsigned long step;
+	undo *u;
+	tmtape *t;
+
+	if (!(step = curstep(d)))
+		return -1;
+
+	if (!d->nlog) {
+		loadsnap(d, (step - 1) / SNAPSTEPS);
+		while (curstep(d) < step - 1)
+			forward(d);
+		return 0;
+	}
+
+	t = d->tm->tape;
+	u = &d->log[--d->nlog];
+
+	/* A newly accessed cell is always blank and adjacent to the head. */
+	switch ((direction)u->dir) {
+	case RIGHT:
+		if (u->grown)
+			t->hi--;
+		t->head--;
+		break;
+	case LEFT:
+		if (u->grown)
+			t->lo++;
+		t->head++;
+		break;
+	case STAY:
+		/* Nothing to do here. */
+		break;
+	}
+
+	setcell(t, t->head, u->code);
+	d->state = u->state;
+	d->tm->steps--;
+
+	return 0;
+}
+
+/**
+ * Moves the turing machine to the given step. Requires at most one
+ * snapshot restore and SNAPSTEPS steps, unless the step wasn't reached
+ * before. Stops early if the machine halts.
+ *
+ * @param d Debugging session.
+ * @param target Step the machine should be moved to.
+ */
+static void
+seek(debugger *d, unsigned long target)
+{
+	unsigned long step;
+
+	step = curstep(d);
+	if (target < step && step - target > d->nlog)
+		loadsnap(d, target / SNAPSTEPS);
+
+	while (curstep(d) > target)
+		backward(d);
+	while (curstep(d) < target && !forward(d))
+		;
+}
+
+/**
+ * Writes the current step and state of the turing machine followed by
+ * the verdict if the machine halted.
+ *
+ * @param d Debugging session.
+ * @param stream Stream the status should be written to.
+ */
+static void
+status(debugger *d, FILE *stream)
+{
+	int undef;
+	tmtape *t;
+	tmstate *state;
+	tmtrans *trans;
+
+	t = d->tm->tape;
+	fprintf(stream, "step %lu q%d", curstep(d), d->state);
+
+	if (!(undef = getstate(d->tm, d->state, &state)) && state->dead)
+		fprintf(stream, " rejected");
+	else if (undef || t->head > t->hi ||
+			gettrans(state, readsym(t), &trans))
+		fprintf(stream, " %s", isaccepting(d->tm, d->state) ?
+			"rejected" : "accepted");
+
+	fputc('\n', stream);
+}
+
+/**
+ * Writes the cells surrounding the head followed by a line marking
+ * the cell the head is positioned on.
+ *
+ * @param d Debugging session.
+ * @param stream Stream the cells should be written to.
+ */
+static void
+window(debugger *d, FILE *stream)
+{
+	size_t lo;
+	tmtape *t;
+
+	t = d->tm->tape;
+	lo = (t->head - t->lo > DEBUGWINDOW) ? t->head - DEBUGWINDOW : t->lo;
+
+	printwindow(t, stream, DEBUGWINDOW);
+	fprintf(stream, "\n%*s^\n", (int)(t->head - lo), "");
+}
+
+/**
+ * Starts an interactive debugging session for the given turing machine
+ * whose input was already written to the tape. Commands are read line
+ * by line from the given input stream:
+ *
+ * 	s [n]  Perform n steps (default 1).
+ * 	b [n]  Revert n steps (default 1).
+ * 	g n    Go to step n.
+ * 	c      Continue until the machine halts.
+ * 	p      Print the cells surrounding the head.
+ * 	t      Print the entire tape.
+ * 	q      Quit.
+ *
+ * @param tm Turing machine which should be debugged.
+ * @param in Stream to read commands from.
+ * @param out Stream to write output to.
+ */
+void
+debugtm(dtm *tm, FILE *in, FILE *out)
+{
+	int n;
+	char cmd;
+	unsigned long arg;
+	char line[BUFSIZ];
+	debugger d;
+
+	d.tm = tm;
+	d.state = tm->start;
+	d.base = tm->steps;
+	d.snaps = NULL;
+	d.nsnaps = 0;
+	d.log = emalloc(SNAPSTEPS * sizeof(undo));
+	d.nlog = 0;
+
+	status(&d, out);
+	while (fflush(out), fgets(line, sizeof(line), in)) {
+		if ((n = sscanf(line, " %c %lu", &cmd, &arg)) < 1)
+			continue;
+		if (n == 1)
+			arg = 1;
+
+		switch (cmd) {
+		case 's':
+			while (arg-- && !forward(&d))
+				;
+			break;
+		case 'b':
+			while (arg-- && !backward(&d))
+				;
+			break;
+		case 'g':
+			if (n != 2)
+				goto unknown;
+			seek(&d, arg);
+			break;
+		case 'c':
+			while (!forward(&d))
+				;
+			break;
+		case 'p':
+			window(&d, out);
+			continue;
+		case 't':
+			printcells(tm->tape, out);
+			fputc('\n', out);
+			continue;
+		case 'q':
+			goto quit;
+		default:
+unknown:
+			fprintf(out, "?\n");
+			continue;
+		}
+
+		status(&d, out);
+	}
+
+quit:
+	while (d.nsnaps--)
+		free(d.snaps[d.nsnaps].buf);
+	free(d.snaps);
+	free(d.log);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_DEBUG_H
+#define TMSIM_DEBUG_H
+
+#include <stdio.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Amount of steps between two snapshots of the tape. Bounds the
+	 * amount of steps performed when seeking to an arbitrary step.
+	 */
+	SNAPSTEPS = 1 << 16,
+
+	/**
+	 * Amount of cells printed on each side of the head.
+	 */
+	DEBUGWINDOW = 32,
+};
+
+void debugtm(dtm *, FILE *, FILE *);
+
+#endif
@@ -0,0 +1,494 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+
+#include "batch.h"
+#include "enumerate.h"
+#include "parser.h"
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+enum {
+	/**
+	 * Default amount of differing inputs which are reported.
+	 */
+	DIFFREPORT = 10,
+};
+
+/**
+ * Outcome of running one of the machines on an input.
+ */
+typedef struct _outcome outcome;
+
+struct _outcome {
+	enumres res;         /**< Result of the run. */
+	unsigned long steps; /**< Amount of steps performed. */
+	tmtape *tape;        /**< Final tape, freed after the comparison. */
+
+	/**
+	 * Trimmed tape content allocated using open_memstream(3) or NULL
+	 * if it wasn't needed.
+	 */
+	char *cells;
+	size_t len; /**< Length of the tape content. */
+};
+
+/**
+ * Input on which the machines differ.
+ */
+typedef struct _mismatch mismatch;
+
+struct _mismatch {
+	uint64_t num;   /**< Number of the input. */
+	char *input;    /**< The input itself. */
+	outcome out[2]; /**< Outcome of both machines. */
+};
+
+/**
+ * Both machines, shared by all worker threads and never modified.
+ */
+static dtm *machines[2];
+
+/**
+ * Inputs read from a file or NULL if all inputs up to maxlen over
+ * the input alphabet of both machines are enumerated.
+ */
+static tmbatch *batch;
+static tmalpha alpha;
+static size_t maxlen;
+
+static uint64_t total;       /**< Amount of inputs. */
+static unsigned long budget; /**< Maximum amount of steps per run. */
+static size_t report;        /**< Amount of reported inputs or 0. */
+static int cmptapes;         /**< Whether final tapes are compared. */
+
+/**
+ * Differing inputs found so far. As soon as the amount of reported
+ * inputs is known to be found, inputs with larger numbers are no
+ * longer claimed. Protected by lock.
+ */
+static mismatch *diffs;
+static size_t ndiffs, diffsiz;
+static uint64_t limit = UINT64_MAX;
+
+static uint64_t next;     /**< Number of the next unclaimed input. */
+static uint64_t checked;  /**< Amount of inputs run on both machines. */
+static uint64_t differing; /**< Amount of differing inputs. */
+static uint64_t undecided; /**< Amount of inputs exceeding the budget. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Writes the usage string for this program to stderr and terminates
+ * the program with EXIT_FAILURE.
+ */
+static void
+usage(char *prog)
+{
+	fprintf(stderr, "USAGE: %s %s\n", prog,
+		"[-n steps] [-j threads] [-m count] [-t] [-h|-v] "
+		"-l length|-i inputs FILE FILE");
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Runs the given machine on the given input. The states of the machine
+ * are shared, each run uses its own tape.
+ *
+ * @param tm Turing machine which should be run.
+ * @param in Input for the machine.
+ * @param o Pointer to store the outcome of the run at.
+ */
+static void
+runone(dtm *tm, char *in, outcome *o)
+{
+	int exceeded, ret;
+	dtm run;
+
+	run = *tm;
+	run.tape = blanktape(tm->tape);
+	appendtape(run.tape, in);
+
+	exceeded = 0;
+	run.profile = 0;
+	run.steps = 0;
+	run.hook = budgethook;
+	run.hookarg = &exceeded;
+	run.hookat = budget;
+
+	ret = runtm(&run);
+	if (exceeded)
+		o->res = ENUM_TIMEOUT;
+	else
+		o->res = (ret) ? ENUM_REJECT : ENUM_ACCEPT;
+
+	o->steps = run.steps;
+	o->tape = run.tape;
+	o->cells = NULL;
+	o->len = 0;
+}
+
+/**
+ * Stores the trimmed content of the final tape of a run.
+ *
+ * @param o Outcome of the run.
+ */
+static void
+tapecells(outcome *o)
+{
+	FILE *stream;
+
+	if (!(stream = open_memstream(&o->cells, &o->len)))
+		die("open_memstream failed");
+	printtrimmed(o->tape, stream);
+	if (fclose(stream))
+		die("couldn't write tape");
+}
+
+/**
+ * Compares two mismatches by the number of their input.
+ *
+ * @param a Pointer to the first mismatch.
+ * @param b Pointer to the second mismatch.
+ * @returns Result of the comparison as expected by qsort(3).
+ */
+static int
+cmpdiff(const void *a, const void *b)
+{
+	uint64_t x, y;
+
+	x = ((const mismatch *)a)->num;
+	y = ((const mismatch *)b)->num;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Sorts the differing inputs and drops all but the reported ones.
+ *
+ * @pre lock must be held unless all workers finished.
+ */
+static void
+trimdiffs(void)
+{
+	size_t i;
+
+	qsort(diffs, ndiffs, sizeof(mismatch), cmpdiff);
+	if (!report || ndiffs < report)
+		return;
+
+	for (i = report; i < ndiffs; i++) {
+		free(diffs[i].input);
+		free(diffs[i].out[0].cells);
+		free(diffs[i].out[1].cells);
+	}
+
+	ndiffs = report;
+	limit = diffs[report - 1].num;
+}
+
+/**
+ * Records an input on which the machines differ. The tape content of
+ * both outcomes must have been stored.
+ *
+ * @param num Number of the input.
+ * @param in The input.
+ * @param len Length of the input.
+ * @param out Outcomes of both machines.
+ */
+static void
+adddiff(uint64_t num, char *in, size_t len, outcome *out)
+{
+	size_t size;
+	mismatch *m;
+
+	pthread_mutex_elock(&lock);
+	differing++;
+	if (num > limit) {
+		pthread_mutex_eunlock(&lock);
+		free(out[0].cells);
+		free(out[1].cells);
+		return;
+	}
+
+	if (ndiffs == diffsiz) {
+		size = (diffsiz) ? diffsiz * 2 : 16;
+		diffs = tagrealloc(MEM_OTHER, diffs, diffsiz * sizeof(mismatch),
+			size * sizeof(mismatch));
+		diffsiz = size;
+	}
+
+	m = &diffs[ndiffs++];
+	m->num = num;
+	m->input = estrndup(in, len);
+	m->out[0] = out[0];
+	m->out[1] = out[1];
+
+	/* Sorting only once twice as many inputs as reported were found
+	 * keeps insertions amortized constant. */
+	if (report && ndiffs >= 2 * report)
+		trimdiffs();
+	pthread_mutex_eunlock(&lock);
+}
+
+/**
+ * Runs both machines on the given input and records it if they differ.
+ *
+ * @param num Number of the input.
+ * @param in The input, terminated by a null byte.
+ * @param len Length of the input.
+ * @returns Non-zero if a run exceeded the step budget.
+ */
+static int
+compare(uint64_t num, char *in, size_t len)
+{
+	int diff, i;
+	outcome out[2];
+
+	runone(machines[0], in, &out[0]);
+	runone(machines[1], in, &out[1]);
+
+	diff = 0;
+	if (out[0].res == ENUM_TIMEOUT || out[1].res == ENUM_TIMEOUT) {
+		/* A longer run might still agree, the input is undecided. */
+	} else if (out[0].res != out[1].res) {
+		diff = 1;
+	} else if (cmptapes) {
+		tapecells(&out[0]);
+		tapecells(&out[1]);
+		diff = out[0].len != out[1].len ||
+			memcmp(out[0].cells, out[1].cells, out[0].len);
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (diff && !out[i].cells)
+			tapecells(&out[i]);
+		freetape(out[i].tape);
+	}
+
+	if (diff) {
+		adddiff(num, in, len, out);
+	} else {
+		free(out[0].cells);
+		free(out[1].cells);
+	}
+
+	return out[0].res == ENUM_TIMEOUT || out[1].res == ENUM_TIMEOUT;
+}
+
+/**
+ * Thread claiming chunks of inputs and running both machines on them.
+ *
+ * @param arg Unused.
+ */
+static void *
+diffworker(void *arg)
+{
+	size_t len, max;
+	uint64_t num, end, runs, timeouts;
+	char *buf;
+
+	(void)arg;
+
+	if (batch)
+		for (max = 0, num = 0; num < batch->n; num++)
+			max = (batch->size[num] > max) ? batch->size[num] : max;
+	else
+		max = maxlen + 1;
+	buf = emalloc(max + 1);
+
+	runs = timeouts = 0;
+	for (;;) {
+		pthread_mutex_elock(&lock);
+		num = next;
+		if (num < total && num <= limit)
+			next = num + ENUMCHUNK;
+		else
+			num = total;
+		pthread_mutex_eunlock(&lock);
+		if (num >= total)
+			break;
+
+		end = (num + ENUMCHUNK < total) ? num + ENUMCHUNK : total;
+		for (len = 0; num < end; num++, runs++) {
+			if (batch) {
+				len = batch->size[num];
+				memcpy(buf, batch->buf + batch->off[num], len);
+			} else if (num % ENUMCHUNK == 0) {
+				len = decodeinput(&alpha, num, buf);
+			} else {
+				len = nextinput(&alpha, buf, len);
+			}
+			buf[len] = '\0';
+
+			if (compare(num, buf, len))
+				timeouts++;
+		}
+	}
+
+	pthread_mutex_elock(&lock);
+	checked += runs;
+	undecided += timeouts;
+	pthread_mutex_eunlock(&lock);
+
+	free(buf);
+	return NULL;
+}
+
+/**
+ * Writes the outcome of a run.
+ *
+ * @param path Path of the machine file.
+ * @param o Outcome of the run.
+ */
+static void
+writeoutcome(char *path, outcome *o)
+{
+	static char *results[] = {
+		[ENUM_ACCEPT] = "accept",
+		[ENUM_REJECT] = "reject",
+		[ENUM_TIMEOUT] = "timeout",
+	};
+
+	printf("%s %s %lu ", path, results[o->res], o->steps);
+	fwrite(o->cells, 1, o->len, stdout);
+	putchar('\n');
+}
+
+/**
+ * The main function invoked when the program is started.
+ *
+ * @param argc Amount of command line parameters.
+ * @param argv Command line parameters.
+ */
+int
+main(int argc, char **argv)
+{
+	int opt, enumerate;
+	size_t i, bad;
+	long nthreads;
+	unsigned long val;
+	char *inputs, *end;
+	pthread_t *thrs;
+
+	inputs = NULL;
+	enumerate = 0;
+	budget = ENUMSTEPS;
+	report = DIFFREPORT;
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "n:j:m:tl:i:hv")) != -1) {
+		switch (opt) {
+		case 'n':
+		case 'm':
+		case 'l':
+			errno = 0;
+			val = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-' ||
+					(opt == 'n' && !val))
+				usage(argv[0]);
+
+			if (opt == 'n')
+				budget = val;
+			else if (opt == 'm')
+				report = val;
+			else
+				maxlen = val;
+			enumerate |= opt == 'l';
+			break;
+		case 'j':
+			errno = 0;
+			nthreads = strtol(optarg, &end, 10);
+			if (errno || *end || nthreads <= 0)
+				usage(argv[0]);
+			break;
+		case 't':
+			cmptapes = 1;
+			break;
+		case 'i':
+			inputs = optarg;
+			break;
+		case 'v':
+			fprintf(stderr, "tmsim-"VERSION"\n");
+			return EXIT_FAILURE;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind + 2 != argc || !enumerate == !inputs)
+		usage(argv[0]);
+	if (nthreads <= 0)
+		nthreads = 1;
+
+	if (!(machines[0] = loadtm(argv[optind])) ||
+			!(machines[1] = loadtm(argv[optind + 1])))
+		return EXIT_FAILURE;
+
+	if (inputs) {
+		if (!(batch = readbatch(inputs, &bad))) {
+			if (errno)
+				die("couldn't read inputs");
+			fprintf(stderr, "%s:%zu: Input can only consist of "
+				"alphanumeric characters.\n", inputs, ++bad);
+			return EXIT_FAILURE;
+		}
+		total = batch->n;
+	} else {
+		inputalpha(&alpha, machines, 2);
+		if (maxlen == SIZE_MAX ||
+				countinputs(&alpha, maxlen, UINT64_MAX, &total)) {
+			fprintf(stderr, "Too many inputs up to length %zu.\n",
+				maxlen);
+			return EXIT_FAILURE;
+		}
+	}
+
+	thrs = emalloc((size_t)nthreads * sizeof(pthread_t));
+	for (i = 0; i < (size_t)nthreads; i++)
+		if ((errno = pthread_create(&thrs[i], NULL, diffworker, NULL)))
+			die("pthread_create failed");
+	for (i = 0; i < (size_t)nthreads; i++)
+		if ((errno = pthread_join(thrs[i], NULL)))
+			die("pthread_join failed");
+	free(thrs);
+
+	trimdiffs();
+	for (i = 0; i < ndiffs; i++) {
+		printf("%sinput %s\n", (i) ? "\n" : "", diffs[i].input);
+		writeoutcome(argv[optind], &diffs[i].out[0]);
+		writeoutcome(argv[optind + 1], &diffs[i].out[1]);
+	}
+	if (fflush(stdout))
+		die("couldn't write results");
+
+	fprintf(stderr, "inputs %"PRIu64"\ndiffering %"PRIu64"\n"
+		"undecided %"PRIu64"\n", checked, differing, undecided);
+
+	return (differing) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,428 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "enumerate.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Adds the symbol read by the given transition to the input alphabet
+ * pointed to by the given void pointer.
+ *
+ * @param trans Transition whose symbol should be added.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a table of UCHAR_MAX + 1 flags.
+ */
+static void
+addinput(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)state;
+
+	if (isalnum((unsigned char)trans->rsym) && trans->rsym != BLANKCHAR)
+		((unsigned char *)arg)[(unsigned char)trans->rsym] = 1;
+}
+
+/**
+ * Adds the symbols read by the transitions of the given state to the
+ * input alphabet pointed to by the given void pointer.
+ *
+ * @param state State whose transitions should be considered.
+ * @param arg Void pointer to a table of UCHAR_MAX + 1 flags.
+ */
+static void
+addinputs(tmstate *state, void *arg)
+{
+	eachtrans(state, addinput, arg);
+}
+
+/**
+ * Initializes an input alphabet with the symbols read by the
+ * transitions of the given machines.
+ *
+ * @param a Input alphabet which should be initialized.
+ * @param tms Turing machines whose symbols should be used.
+ * @param n Amount of turing machines.
+ */
+void
+inputalpha(tmalpha *a, dtm **tms, size_t n)
+{
+	size_t i;
+	unsigned char used[UCHAR_MAX + 1];
+
+	memset(used, 0, sizeof(used));
+	for (i = 0; i < n; i++)
+		eachstate(tms[i], addinputs, used);
+
+	for (a->nsyms = 0, i = 0; i <= UCHAR_MAX; i++) {
+		a->ranks[i] = (unsigned char)a->nsyms;
+		if (used[i])
+			a->syms[a->nsyms++] = (char)i;
+	}
+}
+
+/**
+ * Calculates the amount of inputs up to the given length.
+ *
+ * @param a Input alphabet of the inputs.
+ * @param maxlen Maximum length of an input.
+ * @param max Maximum amount of inputs.
+ * @param dest Pointer to store the amount of inputs at.
+ * @returns 0 on success, -1 if there are more than max inputs.
+ */
+int
+countinputs(tmalpha *a, size_t maxlen, uint64_t max, uint64_t *dest)
+{
+	size_t i;
+	uint64_t total, count;
+
+	for (total = count = 1, i = 1; i <= maxlen && a->nsyms; i++) {
+		if (count > max / a->nsyms)
+			return -1;
+		count *= a->nsyms;
+		if (count > max - total)
+			return -1;
+		total += count;
+	}
+
+	*dest = total;
+	return 0;
+}
+
+/**
+ * Stores the input with the given number in the given buffer.
+ *
+ * @param a Input alphabet of the input.
+ * @param num Number of the input.
+ * @param buf Buffer large enough for the input.
+ * @returns Length of the input.
+ */
+size_t
+decodeinput(tmalpha *a, uint64_t num, char *buf)
+{
+	size_t i, len;
+	uint64_t count;
+
+	for (len = 0, count = 1; num >= count; len++) {
+		num -= count;
+		count *= a->nsyms;
+	}
+
+	for (i = len; i > 0; i--) {
+		buf[i - 1] = a->syms[num % a->nsyms];
+		num /= a->nsyms;
+	}
+
+	return len;
+}
+
+/**
+ * Replaces the given input with its successor in shortlex order.
+ *
+ * @param a Input alphabet of the input.
+ * @param buf Buffer containing the input, must be large enough for
+ * 	the successor.
+ * @param len Length of the input.
+ * @returns Length of the successor.
+ */
+size_t
+nextinput(tmalpha *a, char *buf, size_t len)
+{
+	size_t i, j;
+
+	for (i = len; i > 0; i--) {
+		j = a->ranks[(unsigned char)buf[i - 1]];
+		if (j + 1 < a->nsyms) {
+			buf[i - 1] = a->syms[j + 1];
+			return len;
+		}
+		buf[i - 1] = a->syms[0];
+	}
+
+	/* All symbols wrapped around, continue with the next length. */
+	buf[len] = a->syms[0];
+	return len + 1;
+}
+
+/**
+ * Prepares the enumeration of all inputs up to the given length over
+ * the given input alphabet. The alphabet has to be determined using
+ * ::inputalpha before the machine is optimized, optimizations remove
+ * transitions and thus their symbols.
+ *
+ * @param a Input alphabet of the turing machine.
+ * @param d Dense table of the turing machine.
+ * @param maxlen Maximum length of an input.
+ * @param budget Maximum amount of steps performed for a single input.
+ * @returns Pointer to the enumeration or NULL if there are too many
+ * 	inputs to store their results in memory.
+ */
+tmenum *
+newenum(tmalpha *a, tmdense *d, size_t maxlen, unsigned long budget)
+{
+	uint64_t total;
+	tmenum *e;
+
+	e = emalloc(sizeof(tmenum));
+	e->alpha = *a;
+
+	/* The bitmap has to be addressable, see ::writebitmap. */
+	if (countinputs(&e->alpha, maxlen, SIZE_MAX / CHAR_BIT, &total)) {
+		free(e);
+		return NULL;
+	}
+
+	e->dense = d;
+	e->maxlen = maxlen;
+	e->total = total;
+	e->budget = budget;
+	e->next = 0;
+	memset(e->counts, 0, sizeof(e->counts));
+
+	e->accepted = emalloc((size_t)(total / CHAR_BIT + 1));
+	memset(e->accepted, 0, (size_t)(total / CHAR_BIT + 1));
+
+	if ((errno = pthread_mutex_init(&e->lock, NULL)))
+		die("pthread_mutex_init failed");
+
+	return e;
+}
+
+/**
+ * Frees all resources allocated for an enumeration. The dense table
+ * isn't freed.
+ *
+ * @param e Enumeration which should be freed.
+ */
+void
+freeenum(tmenum *e)
+{
+	assert(e);
+
+	if ((errno = pthread_mutex_destroy(&e->lock)))
+		die("pthread_mutex_destroy failed");
+
+	free(e->accepted);
+	free(e);
+}
+
+/**
+ * Runs the machine on the input written to the given tape.
+ *
+ * @param e Enumeration whose machine and budget should be used.
+ * @param t Tape containing the input.
+ * @param head Position of the first input cell.
+ * @returns Result of the run.
+ */
+static enumres
+runinput(tmenum *e, lanetape *t, size_t head)
+{
+	tmdense *d;
+	uint32_t state, ent;
+	unsigned long steps;
+
+	d = e->dense;
+	state = d->start;
+	for (steps = 0;; steps++) {
+		ent = d->table[state * d->ncols + t->cells[head]];
+		if (ent == DENSEHALT)
+			return (d->flags[state] & DENSE_ACCEPT) ?
+				ENUM_ACCEPT : ENUM_REJECT;
+		else if (steps == e->budget)
+			return ENUM_TIMEOUT;
+
+		t->cells[head] = densesym(ent);
+		if (densedir(ent) == RIGHT)
+			head++;
+		else if (densedir(ent) == LEFT)
+			head--;
+		state = densenext(ent);
+
+		if (d->flags[state] & DENSE_DEAD)
+			return ENUM_REJECT;
+		else if (head - 1 >= t->size - 2)
+			head += growlane(t);
+	}
+}
+
+/**
+ * Thread claiming chunks of inputs and running the machine on them.
+ * The tape and the input buffer are reused for all inputs.
+ *
+ * @param arg Void pointer to the enumeration.
+ */
+static void *
+enumworker(void *arg)
+{
+	size_t len;
+	uint64_t num, end;
+	uint64_t counts[ENUM_NRESULTS];
+	enumres res;
+	tmenum *e;
+	tmdense *d;
+	lanetape tape;
+	char *buf;
+
+	e = arg;
+	d = e->dense;
+	tape.cells = NULL;
+	tape.size = 0;
+	buf = emalloc(e->maxlen + 1);
+	memset(counts, 0, sizeof(counts));
+
+	for (;;) {
+		pthread_mutex_elock(&e->lock);
+		num = e->next;
+		e->next = (num < e->total) ? num + ENUMCHUNK : num;
+		pthread_mutex_eunlock(&e->lock);
+		if (num >= e->total)
+			break;
+
+		end = (num + ENUMCHUNK < e->total) ? num + ENUMCHUNK : e->total;
+		for (len = decodeinput(&e->alpha, num, buf); num < end; num++) {
+			/* The empty input doesn't run, see ::runtm. */
+			if (!len)
+				res = (d->flags[d->start] & DENSE_ACCEPT) ?
+					ENUM_ACCEPT : ENUM_REJECT;
+			else if (d->flags[d->start] & DENSE_DEAD)
+				res = ENUM_REJECT;
+			else
+				res = runinput(e, &tape,
+					filllane(d, &tape, buf, len));
+
+			counts[res]++;
+			if (res == ENUM_ACCEPT)
+				e->accepted[num / CHAR_BIT] |=
+					(unsigned char)(1U << (num % CHAR_BIT));
+			if (num + 1 < end)
+				len = nextinput(&e->alpha, buf, len);
+		}
+	}
+
+	pthread_mutex_elock(&e->lock);
+	for (res = ENUM_ACCEPT; res < ENUM_NRESULTS; res++)
+		e->counts[res] += counts[res];
+	pthread_mutex_eunlock(&e->lock);
+
+	free(tape.cells);
+	free(buf);
+	return NULL;
+}
+
+/**
+ * Runs the machine on all inputs of the enumeration using the given
+ * amount of threads.
+ *
+ * @param e Enumeration which should be run.
+ * @param nthreads Amount of threads.
+ */
+void
+runenum(tmenum *e, unsigned int nthreads)
+{
+	unsigned int i;
+	pthread_t *thrs;
+
+	thrs = emalloc(nthreads * sizeof(pthread_t));
+	for (i = 0; i < nthreads; i++)
+		if ((errno = pthread_create(&thrs[i], NULL, enumworker, e)))
+			die("pthread_create failed");
+	for (i = 0; i < nthreads; i++)
+		if ((errno = pthread_join(thrs[i], NULL)))
+			die("pthread_join failed");
+
+	free(thrs);
+}
+
+/**
+ * Returns whether the input with the given number was accepted.
+ *
+ * @param e Enumeration which was run.
+ * @param num Number of the input.
+ * @returns Non-zero if the input was accepted.
+ */
+static int
+isaccepted(tmenum *e, uint64_t num)
+{
+	return e->accepted[num / CHAR_BIT] & (1U << (num % CHAR_BIT));
+}
+
+/**
+ * Writes the accepted inputs in shortlex order to the given stream,
+ * one input per line.
+ *
+ * @param e Enumeration which was run.
+ * @param stream Stream the inputs should be written to.
+ */
+void
+writeaccepted(tmenum *e, FILE *stream)
+{
+	size_t len;
+	uint64_t num;
+	char *buf;
+
+	/* The newline follows the input in the buffer, each accepted
+	 * input is thus written using a single call. */
+	buf = emalloc(e->maxlen + 2);
+	for (len = 0, num = 0; num < e->total; num++) {
+		if (isaccepted(e, num)) {
+			buf[len] = '\n';
+			fwrite(buf, 1, len + 1, stream);
+		}
+		if (num + 1 < e->total)
+			len = nextinput(&e->alpha, buf, len);
+	}
+
+	free(buf);
+}
+
+/**
+ * Writes the accepted inputs as a run-length encoded bitmap to the
+ * given stream. The bitmap consists of the lengths of alternating runs
+ * of rejected and accepted inputs in shortlex order, starting with
+ * rejected inputs, each encoded as a varint.
+ *
+ * @param e Enumeration which was run.
+ * @param stream Stream the bitmap should be written to.
+ */
+void
+writebitmap(tmenum *e, FILE *stream)
+{
+	int accept;
+	uint64_t num, run;
+
+	for (accept = 0, run = 0, num = 0; num < e->total; num++) {
+		if (!isaccepted(e, num) != !accept) {
+			putvarint(stream, run);
+			accept = !accept;
+			run = 0;
+		}
+		run++;
+	}
+
+	putvarint(stream, run);
+}
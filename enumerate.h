@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_ENUMERATE_H
+#define TMSIM_ENUMERATE_H
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "batch.h"
+#include "turing.h"
+
+enum {
+	/**
+	 * Amount of inputs claimed by a thread at once. Must be a multiple
+	 * of CHAR_BIT, threads thus never share a byte of the bitmap.
+	 */
+	ENUMCHUNK = 1 << 12,
+
+	/**
+	 * Default maximum amount of steps performed for a single input.
+	 */
+	ENUMSTEPS = 1 << 20,
+};
+
+/**
+ * Input alphabet used to enumerate inputs. Inputs are numbered in
+ * shortlex order, i.e. ordered by length and lexicographically within
+ * the same length.
+ */
+typedef struct _tmalpha tmalpha;
+
+struct _tmalpha {
+	char syms[UCHAR_MAX + 1]; /**< Input symbols in ascending order. */
+	size_t nsyms;             /**< Amount of input symbols. */
+	unsigned char ranks[UCHAR_MAX + 1]; /**< Index of each input symbol. */
+};
+
+/**
+ * Result of running a machine on a single enumerated input.
+ */
+typedef enum {
+	ENUM_ACCEPT,  /**< The input was accepted. */
+	ENUM_REJECT,  /**< The input was rejected. */
+	ENUM_TIMEOUT, /**< The step budget was exhausted. */
+	ENUM_NRESULTS, /**< Amount of results, not a valid result. */
+} enumres;
+
+/**
+ * Enumeration of all inputs up to a maximum length over the input
+ * alphabet of a machine.
+ */
+typedef struct _tmenum tmenum;
+
+struct _tmenum {
+	tmdense *dense;  /**< Dense table of the machine. */
+	size_t maxlen;   /**< Maximum length of an input. */
+	uint64_t total;  /**< Amount of inputs. */
+	unsigned long budget; /**< Maximum amount of steps per input. */
+
+	tmalpha alpha; /**< Input alphabet of the machine. */
+
+	unsigned char *accepted;  /**< Bitmap of the accepted inputs. */
+	uint64_t counts[ENUM_NRESULTS]; /**< Amount of inputs per result. */
+
+	uint64_t next;        /**< Number of the next unclaimed input. */
+	pthread_mutex_t lock; /**< Protects next and counts. */
+};
+
+void inputalpha(tmalpha *, dtm **, size_t);
+int countinputs(tmalpha *, size_t, uint64_t, uint64_t *);
+size_t decodeinput(tmalpha *, uint64_t, char *);
+size_t nextinput(tmalpha *, char *, size_t);
+
+tmenum *newenum(tmalpha *, tmdense *, size_t, unsigned long);
+void freeenum(tmenum *);
+void runenum(tmenum *, unsigned int);
+void writeaccepted(tmenum *, FILE *);
+void writebitmap(tmenum *, FILE *);
+
+#endif
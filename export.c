@@ -16,6 +16,7 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -23,7 +24,9 @@
 #include <sys/types.h>
 
 #include "turing.h"
+#include "optimize.h"
 #include "parser.h"
+#include "profile.h"
 #include "util.h"
 
 /**
@@ -42,6 +45,97 @@ static char *initialshape = "diamond";
  */
 static char *acceptingshape = "doublecircle";
 
+/**
+ * Whether states and transitions are colored by the counts of a
+ * transition frequency profile.
+ */
+static int heatmap = 0;
+
+/**
+ * Transitions performed less often than this are omitted from a heatmap.
+ */
+static unsigned long threshold = 0;
+
+/**
+ * Highest count of a single transition, used to scale the heatmap.
+ */
+static unsigned long maxtrans = 0;
+
+/**
+ * Highest sum of the counts of the transitions of a single state.
+ */
+static unsigned long maxstate = 0;
+
+/**
+ * Returns the number of bits required to represent the given value.
+ * Used as a cheap logarithm, profile counts usually span many orders
+ * of magnitude.
+ *
+ * @param val Value whose bit length should be returned.
+ * @returns Bit length of the value.
+ */
+static unsigned int
+bitlen(unsigned long val)
+{
+	unsigned int n;
+
+	for (n = 0; val; n++)
+		val >>= 1;
+	return n;
+}
+
+/**
+ * Returns the heat of a count in relation to a maximum count on a
+ * logarithmic scale.
+ *
+ * @param count Count whose heat should be calculated.
+ * @param max Maximum count.
+ * @returns Heat between 0.0 (never performed) and 1.0 (hottest).
+ */
+static double
+heat(unsigned long count, unsigned long max)
+{
+	return (max) ? (double)bitlen(count) / (double)bitlen(max) : 0.0;
+}
+
+/**
+ * Adds the count of a transition to the sum pointed to by the given
+ * void pointer.
+ *
+ * @param trans Transition whose count should be added.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to the sum.
+ */
+static void
+sumtrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)state;
+
+	*(unsigned long *)arg += trans->count;
+	if (trans->count > maxtrans)
+		maxtrans = trans->count;
+}
+
+/**
+ * Updates the maximum counts used to scale the heatmap with the counts
+ * of the given state and its transitions.
+ *
+ * @param state State whose counts should be considered.
+ * @param arg Unused.
+ */
+static void
+maxheat(tmstate *state, void *arg)
+{
+	unsigned long sum;
+
+	(void)arg;
+
+	sum = 0;
+	eachtrans(state, sumtrans, &sum);
+	if (sum > maxstate)
+		maxstate = sum;
+}
+
 /**
  * Writes the dot language reprasentation for a given transition
  * from a given state to a given stream.
@@ -53,15 +147,30 @@ static char *acceptingshape = "doublecircle";
 static void
 exporttrans(tmtrans *trans, tmstate *state, void *arg)
 {
-	fprintf(arg, "q%d -> q%d [label=\"%c/%c/%c\"];\n",
-		state->name, trans->nextstate,
-		trans->rsym, trans->wsym,
-		dirstr(trans->headdir));
+	double h;
+
+	if (!heatmap) {
+		fprintf(arg, "q%d -> q%d [label=\"%c/%c/%c\"];\n",
+			state->name, trans->nextstate,
+			trans->rsym, trans->wsym,
+			dirstr(trans->headdir));
+		return;
+	} else if (trans->count < threshold) {
+		return;
+	}
+
+	h = heat(trans->count, maxtrans);
+	fprintf(arg, "q%d -> q%d [label=\"%c/%c/%c (%lu)\", "
+		"color=\"%.3f 1.000 %.3f\", penwidth=%.2f];\n",
+		state->name, trans->nextstate, trans->rsym, trans->wsym,
+		dirstr(trans->headdir), trans->count, 0.667 * (1.0 - h),
+		0.5 + 0.5 * h, 1.0 + 4.0 * h);
 }
 
 /**
  * Writes the dot language reprasentation for a given state
- * to a given stream.
+ * to a given stream. For heatmaps the state is filled with a color
+ * according to the amount of transitions performed from it.
  *
  * @param state State to create dot markup for.
  * @param arg Void pointer to a stream the output should be written to.
@@ -69,6 +178,18 @@ exporttrans(tmtrans *trans, tmstate *state, void *arg)
 static void
 exportstate(tmstate *state, void *arg)
 {
+	unsigned long sum;
+
+	if (heatmap) {
+		sum = 0;
+		eachtrans(state, sumtrans, &sum);
+		if (sum >= threshold)
+			fprintf(arg, "q%d [style=filled, "
+				"fillcolor=\"%.3f 0.600 1.000\"];\n",
+				state->name,
+				0.667 * (1.0 - heat(sum, maxstate)));
+	}
+
 	eachtrans(state, exporttrans, arg);
 }
 
@@ -92,10 +213,62 @@ export(dtm *tm, FILE *stream)
 		fprintf(stream, "q%d;\n", tm->accept[i]);
 
 	fprintf(stream, "\nnode [shape = %s];\n", nodeshape);
+	if (heatmap)
+		eachstate(tm, maxheat, NULL);
 	eachstate(tm, exportstate, stream);
 	fprintf(stream, "}\n");
 }
 
+/**
+ * Writes the tmsim input format representation for a given transition
+ * to a given stream.
+ *
+ * @param trans Transition to create tmsim markup for.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a stream the output should be written to.
+ */
+static void
+writetrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)state;
+
+	fprintf(arg, "\t%c %c %c => q%d;\n", trans->rsym,
+		dirsym(trans->headdir), trans->wsym, trans->nextstate);
+}
+
+/**
+ * Writes the tmsim input format representation for a given state
+ * to a given stream.
+ *
+ * @param state State to create tmsim markup for.
+ * @param arg Void pointer to a stream the output should be written to.
+ */
+static void
+writestate(tmstate *state, void *arg)
+{
+	fprintf(arg, "\nq%d {\n", state->name);
+	eachtrans(state, writetrans, arg);
+	fprintf(arg, "}\n");
+}
+
+/**
+ * Writes the tmsim input format representation for a given turing
+ * machine to a given stream. The output can be read by tmsim again.
+ *
+ * @param tm Turing machine to create tmsim markup for.
+ * @param stream Stream to write tmsim markup to.
+ */
+static void
+writetm(dtm *tm, FILE *stream)
+{
+	fprintf(stream, "start: q%d;\naccept: ", tm->start);
+	for (size_t i = 0; i < tm->acceptsiz; i++)
+		fprintf(stream, "%sq%d", (i) ? ", " : "", tm->accept[i]);
+	fprintf(stream, ";\n");
+
+	eachstate(tm, writestate, stream);
+}
+
 /**
  * Writes the usage string for this program to stderr and terminates
  * the programm with EXIT_FAILURE.
@@ -105,7 +278,8 @@ usage(char *prog)
 {
 	fprintf(stderr, "USAGE: %s %s\n", prog,
 		"[-s nodeshape] [-i initialshape]\n"
-		"\t[-a acceptingshape] [-o path] [-h|-v] FILE");
+		"\t[-a acceptingshape] [-o path] [-p profile [-m count]] "
+		"[-O] [-t]\n\t[-h|-v] FILE");
 
 	exit(EXIT_FAILURE);
 }
@@ -119,16 +293,18 @@ usage(char *prog)
 int
 main(int argc, char **argv)
 {
-	int opt;
+	int opt, optimize, tmout;
 	parerr ret;
 	dtm *tm;
 	parser *par;
-	char *fc, *fp;
-	FILE *ofd;
+	char *fc, *fp, *pin, *end;
+	FILE *ofd, *pfd;
 	ssize_t len;
 
 	ofd = stdout;
-	while ((opt = getopt(argc, argv, "s:i:a:o:hv")) != -1) {
+	pin = NULL;
+	optimize = tmout = 0;
+	while ((opt = getopt(argc, argv, "s:i:a:o:p:m:Othv")) != -1) {
 		switch (opt) {
 		case 's':
 			nodeshape = optarg;
@@ -143,6 +319,21 @@ main(int argc, char **argv)
 			if (!(ofd = fopen(optarg, "w")))
 				die("couldn't open output file");
 			break;
+		case 'p':
+			pin = optarg;
+			break;
+		case 'm':
+			errno = 0;
+			threshold = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-')
+				usage(argv[0]);
+			break;
+		case 'O':
+			optimize = 1;
+			break;
+		case 't':
+			tmout = 1;
+			break;
 		case 'v':
 			fprintf(stderr, "tmsim-"VERSION"\n");
 			return EXIT_FAILURE;
@@ -167,6 +358,24 @@ main(int argc, char **argv)
 	}
 	freeparser(par);
 
-	export(tm, ofd);
+	/* State names of the profile refer to the unminimized machine. */
+	if (pin) {
+		if (!(pfd = fopen(pin, "r")))
+			die("couldn't open profile");
+		if (readprofile(tm, pfd)) {
+			fprintf(stderr, "%s: Malformed profile.\n", pin);
+			return EXIT_FAILURE;
+		}
+		fclose(pfd);
+		heatmap = 1;
+	}
+
+	if (optimize)
+		minimize(tm, 1, 0);
+
+	if (tmout)
+		writetm(tm, ofd);
+	else
+		export(tm, ofd);
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,654 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntm.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * The configuration tree of a nondeterministic machine is explored
+ * breadth-first. All threads expand the configurations of the current
+ * level, the successors form the next level. Successors whose
+ * configuration hash is already contained in the shared visited set
+ * are dropped, each configuration is thus explored at most once.
+ */
+
+/**
+ * Chunk of tape cells. A chunk is shared by all configurations
+ * referencing it and copied by a configuration writing to it while
+ * it is shared.
+ */
+typedef struct _ntmchunk ntmchunk;
+
+struct _ntmchunk {
+	unsigned long refs;     /**< Amount of referencing configurations. */
+	char cells[NTMCHUNK];   /**< Symbol of each cell. */
+};
+
+/**
+ * Configuration of a nondeterministic machine. Positions are relative
+ * to the first input symbol.
+ */
+typedef struct _ntmconf ntmconf;
+
+struct _ntmconf {
+	tmname state; /**< Current state. */
+	long head;    /**< Position of the head. */
+
+	long base;    /**< Position of the first cell of the first chunk. */
+	size_t nchunks;     /**< Amount of chunks. */
+	ntmchunk **chunks;  /**< Chunks, NULL for chunks of blanks. */
+
+	/**
+	 * Sum of the hashes of all non-blank cells. Updated on each write,
+	 * the tape never needs to be rehashed.
+	 */
+	uint64_t hash;
+};
+
+/**
+ * Shard of the visited set, an open addressing hash table of
+ * configuration hashes. Zero marks empty slots.
+ */
+typedef struct _ntmshard ntmshard;
+
+struct _ntmshard {
+	uint64_t *slots;      /**< Hash table. */
+	size_t size;          /**< Amount of slots, a power of two. */
+	size_t used;          /**< Amount of occupied slots. */
+	pthread_mutex_t lock; /**< Protects the shard. */
+};
+
+/**
+ * Level of the configuration tree.
+ */
+typedef struct _ntmlevel ntmlevel;
+
+struct _ntmlevel {
+	ntmconf *confs; /**< Configurations of the level. */
+	size_t n;       /**< Amount of configurations. */
+	size_t size;    /**< Amount of configurations the buffer can hold. */
+};
+
+/**
+ * State of an exploration shared by all threads.
+ */
+typedef struct _ntmsearch ntmsearch;
+
+struct _ntmsearch {
+	dtm *tm;              /**< Machine, never modified. */
+	unsigned long limit;  /**< Maximum depth. */
+	unsigned long depth;  /**< Depth of the current level. */
+
+	ntmlevel cur;  /**< Level which is expanded. */
+	ntmlevel next; /**< Successors of the current level. */
+	size_t claim;  /**< Index of the next unclaimed configuration. */
+
+	int accepted;    /**< Whether an accepting configuration was found. */
+	int done;        /**< Whether the exploration is finished. */
+	ntmconf accept;  /**< Accepting configuration. */
+
+	ntmshard shards[NTMSHARDS]; /**< Visited set. */
+	pthread_mutex_t lock;       /**< Protects the fields above. */
+	pthread_barrier_t barrier;  /**< Separates the levels. */
+};
+
+#ifdef __GNUC__
+#define refinc(c) ((void)__atomic_add_fetch(&(c)->refs, 1, __ATOMIC_RELAXED))
+#define refdec(c) __atomic_sub_fetch(&(c)->refs, 1, __ATOMIC_ACQ_REL)
+#define refget(c) __atomic_load_n(&(c)->refs, __ATOMIC_ACQUIRE)
+#else
+static pthread_mutex_t reflock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+refinc(ntmchunk *c)
+{
+	pthread_mutex_elock(&reflock);
+	c->refs++;
+	pthread_mutex_eunlock(&reflock);
+}
+
+static unsigned long
+refdec(ntmchunk *c)
+{
+	unsigned long refs;
+
+	pthread_mutex_elock(&reflock);
+	refs = --c->refs;
+	pthread_mutex_eunlock(&reflock);
+	return refs;
+}
+
+static unsigned long
+refget(ntmchunk *c)
+{
+	unsigned long refs;
+
+	pthread_mutex_elock(&reflock);
+	refs = c->refs;
+	pthread_mutex_eunlock(&reflock);
+	return refs;
+}
+#endif
+
+/**
+ * Mixes the bits of the given value, see splitmix64.
+ *
+ * @param x Value which should be mixed.
+ * @returns Mixed value.
+ */
+static uint64_t
+mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= UINT64_C(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= UINT64_C(0x94d049bb133111eb);
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * Calculates the hash of a non-blank cell.
+ *
+ * @param pos Position of the cell.
+ * @param sym Symbol of the cell.
+ * @returns Hash of the cell.
+ */
+static uint64_t
+cellhash(long pos, char sym)
+{
+	return mix((uint64_t)pos * UINT64_C(0x9e3779b97f4a7c15) +
+		(unsigned char)sym);
+}
+
+/**
+ * Calculates the hash of a configuration.
+ *
+ * @param c Configuration whose hash should be calculated.
+ * @returns Hash of the configuration, never zero.
+ */
+static uint64_t
+confhash(ntmconf *c)
+{
+	uint64_t h;
+
+	h = c->hash + mix(((uint64_t)(unsigned int)c->state << 32) ^
+		(uint64_t)c->head);
+	return (h) ? h : 1;
+}
+
+/**
+ * Reads the symbol of a cell.
+ *
+ * @param c Configuration to read from.
+ * @param pos Position of the cell.
+ * @returns Symbol of the cell.
+ */
+static char
+readcell(ntmconf *c, long pos)
+{
+	size_t idx;
+	ntmchunk *chunk;
+
+	if (pos < c->base)
+		return BLANKCHAR;
+
+	idx = (size_t)(pos - c->base) / NTMCHUNK;
+	if (idx >= c->nchunks || !(chunk = c->chunks[idx]))
+		return BLANKCHAR;
+
+	return chunk->cells[(size_t)(pos - c->base) % NTMCHUNK];
+}
+
+/**
+ * Drops the reference of a configuration to a chunk and frees the
+ * chunk if it was the last one.
+ *
+ * @param chunk Chunk whose reference should be dropped.
+ */
+static void
+dropchunk(ntmchunk *chunk)
+{
+	if (chunk && !refdec(chunk))
+		free(chunk);
+}
+
+/**
+ * Writes a symbol to a cell. Chunks shared with other configurations
+ * are copied first, chunks are added on demand.
+ *
+ * @param c Configuration to write to.
+ * @param pos Position of the cell.
+ * @param sym Symbol which should be written.
+ */
+static void
+writecell(ntmconf *c, long pos, char sym)
+{
+	char old;
+	size_t idx, grow;
+	ntmchunk *chunk, *copy;
+
+	if ((old = readcell(c, pos)) == sym)
+		return;
+
+	if (pos < c->base) {
+		grow = (size_t)(c->base - pos + NTMCHUNK - 1) / NTMCHUNK;
+		c->chunks = tagrealloc(MEM_OTHER, c->chunks,
+			c->nchunks * sizeof(ntmchunk *),
+			(c->nchunks + grow) * sizeof(ntmchunk *));
+		memmove(c->chunks + grow, c->chunks,
+			c->nchunks * sizeof(ntmchunk *));
+		memset(c->chunks, 0, grow * sizeof(ntmchunk *));
+		c->nchunks += grow;
+		c->base -= (long)(grow * NTMCHUNK);
+	}
+
+	idx = (size_t)(pos - c->base) / NTMCHUNK;
+	if (idx >= c->nchunks) {
+		c->chunks = tagrealloc(MEM_OTHER, c->chunks,
+			c->nchunks * sizeof(ntmchunk *),
+			(idx + 1) * sizeof(ntmchunk *));
+		memset(c->chunks + c->nchunks, 0,
+			(idx + 1 - c->nchunks) * sizeof(ntmchunk *));
+		c->nchunks = idx + 1;
+	}
+
+	if (!(chunk = c->chunks[idx])) {
+		chunk = emalloc(sizeof(ntmchunk));
+		chunk->refs = 1;
+		memset(chunk->cells, BLANKCHAR, NTMCHUNK);
+		c->chunks[idx] = chunk;
+	} else if (refget(chunk) > 1) {
+		copy = emalloc(sizeof(ntmchunk));
+		copy->refs = 1;
+		memcpy(copy->cells, chunk->cells, NTMCHUNK);
+		dropchunk(chunk);
+		c->chunks[idx] = chunk = copy;
+	}
+
+	chunk->cells[(size_t)(pos - c->base) % NTMCHUNK] = sym;
+	if (old != BLANKCHAR)
+		c->hash -= cellhash(pos, old);
+	if (sym != BLANKCHAR)
+		c->hash += cellhash(pos, sym);
+}
+
+/**
+ * Creates a configuration sharing all chunks with the given one.
+ *
+ * @param dest Pointer to store the copy at.
+ * @param src Configuration which should be copied.
+ */
+static void
+copyconf(ntmconf *dest, ntmconf *src)
+{
+	size_t i;
+
+	*dest = *src;
+	dest->chunks = emalloc((src->nchunks ? src->nchunks : 1) *
+		sizeof(ntmchunk *));
+	for (i = 0; i < src->nchunks; i++)
+		if ((dest->chunks[i] = src->chunks[i]))
+			refinc(dest->chunks[i]);
+}
+
+/**
+ * Frees all chunks referenced only by the given configuration.
+ *
+ * @param c Configuration which should be freed.
+ */
+static void
+freeconf(ntmconf *c)
+{
+	size_t i;
+
+	for (i = 0; i < c->nchunks; i++)
+		dropchunk(c->chunks[i]);
+	free(c->chunks);
+}
+
+/**
+ * Adds a configuration to a level.
+ *
+ * @param l Level the configuration should be added to.
+ * @param c Configuration which should be added, moved into the level.
+ */
+static void
+pushconf(ntmlevel *l, ntmconf *c)
+{
+	size_t size;
+
+	if (l->n == l->size) {
+		size = (l->size) ? l->size * 2 : NTMBATCH;
+		l->confs = tagrealloc(MEM_OTHER, l->confs,
+			l->size * sizeof(ntmconf), size * sizeof(ntmconf));
+		l->size = size;
+	}
+
+	l->confs[l->n++] = *c;
+}
+
+/**
+ * Inserts a configuration hash into the visited set.
+ *
+ * @param s Exploration whose visited set should be used.
+ * @param hash Configuration hash, must not be zero.
+ * @returns Non-zero if the hash wasn't contained in the set yet.
+ */
+static int
+visit(ntmsearch *s, uint64_t hash)
+{
+	size_t i, j, size;
+	uint64_t *slots;
+	ntmshard *sh;
+
+	sh = &s->shards[hash & (NTMSHARDS - 1)];
+	pthread_mutex_elock(&sh->lock);
+
+	if (2 * (sh->used + 1) > sh->size) {
+		size = (sh->size) ? sh->size * 2 : 1024;
+		slots = emalloc(size * sizeof(uint64_t));
+		memset(slots, 0, size * sizeof(uint64_t));
+		for (i = 0; i < sh->size; i++) {
+			if (!sh->slots[i])
+				continue;
+			for (j = (size_t)(sh->slots[i] >> 8) & (size - 1);
+					slots[j]; j = (j + 1) & (size - 1))
+				;
+			slots[j] = sh->slots[i];
+		}
+
+		free(sh->slots);
+		sh->slots = slots;
+		sh->size = size;
+	}
+
+	/* The lower bits select the shard, the slot uses the others. */
+	for (i = (size_t)(hash >> 8) & (sh->size - 1); sh->slots[i];
+			i = (i + 1) & (sh->size - 1)) {
+		if (sh->slots[i] == hash) {
+			pthread_mutex_eunlock(&sh->lock);
+			return 0;
+		}
+	}
+
+	sh->slots[i] = hash;
+	sh->used++;
+	pthread_mutex_eunlock(&sh->lock);
+	return 1;
+}
+
+/**
+ * Records an accepting configuration unless another one was already
+ * found on the same level.
+ *
+ * @param s Exploration which found the configuration.
+ * @param c Accepting configuration, freed if it isn't recorded.
+ */
+static void
+accept(ntmsearch *s, ntmconf *c)
+{
+	pthread_mutex_elock(&s->lock);
+	if (!s->accepted) {
+		s->accepted = 1;
+		s->accept = *c;
+		c = NULL;
+	}
+	pthread_mutex_eunlock(&s->lock);
+
+	if (c)
+		freeconf(c);
+}
+
+/**
+ * Expands a configuration, successors are added to the given level.
+ * The configuration itself is reused for the last alternative.
+ *
+ * @param s Exploration the configuration belongs to.
+ * @param c Configuration which should be expanded.
+ * @param out Level successors should be added to.
+ */
+static void
+expand(ntmsearch *s, ntmconf *c, ntmlevel *out)
+{
+	tmstate *state;
+	tmtrans *trans;
+	ntmconf succ;
+
+	if (getstate(s->tm, c->state, &state) ||
+			gettrans(state, readcell(c, c->head), &trans)) {
+		if (!isaccepting(s->tm, c->state))
+			accept(s, c);
+		else
+			freeconf(c);
+		return;
+	}
+
+	for (; trans; trans = trans->alt) {
+		if (trans->alt)
+			copyconf(&succ, c);
+		else
+			succ = *c;
+
+		writecell(&succ, succ.head, trans->wsym);
+		if (trans->headdir == RIGHT)
+			succ.head++;
+		else if (trans->headdir == LEFT)
+			succ.head--;
+		succ.state = trans->nextstate;
+
+		if (visit(s, confhash(&succ)))
+			pushconf(out, &succ);
+		else
+			freeconf(&succ);
+	}
+}
+
+/**
+ * Thread expanding the configurations of each level.
+ *
+ * @param arg Void pointer to the exploration.
+ */
+static void *
+ntmworker(void *arg)
+{
+	int ret;
+	size_t i, end;
+	ntmlevel out;
+	ntmlevel tmp;
+	ntmsearch *s;
+
+	s = arg;
+	memset(&out, 0, sizeof(out));
+
+	for (;;) {
+		for (;;) {
+			pthread_mutex_elock(&s->lock);
+			i = s->claim;
+			if (!s->accepted && i < s->cur.n)
+				s->claim = i + NTMBATCH;
+			else
+				i = s->cur.n;
+			pthread_mutex_eunlock(&s->lock);
+			if (i >= s->cur.n)
+				break;
+
+			end = (i + NTMBATCH < s->cur.n) ? i + NTMBATCH : s->cur.n;
+			for (; i < end; i++) {
+				expand(s, &s->cur.confs[i], &out);
+				s->cur.confs[i].chunks = NULL;
+				s->cur.confs[i].nchunks = 0;
+			}
+		}
+
+		pthread_mutex_elock(&s->lock);
+		for (i = 0; i < out.n; i++)
+			pushconf(&s->next, &out.confs[i]);
+		pthread_mutex_eunlock(&s->lock);
+		out.n = 0;
+
+		ret = pthread_barrier_wait(&s->barrier);
+		if (ret == PTHREAD_BARRIER_SERIAL_THREAD) {
+			/* Configurations skipped after acceptance. */
+			for (i = 0; i < s->cur.n; i++)
+				freeconf(&s->cur.confs[i]);
+
+			tmp = s->cur;
+			s->cur = s->next;
+			s->next = tmp;
+			s->next.n = 0;
+			s->claim = 0;
+
+			if (!s->accepted && s->cur.n)
+				s->depth++;
+			s->done = s->accepted || !s->cur.n ||
+				s->depth >= s->limit;
+		} else if (ret) {
+			errno = ret;
+			die("pthread_barrier_wait failed");
+		}
+
+		if ((ret = pthread_barrier_wait(&s->barrier)) &&
+				ret != PTHREAD_BARRIER_SERIAL_THREAD) {
+			errno = ret;
+			die("pthread_barrier_wait failed");
+		}
+		if (s->done)
+			break;
+	}
+
+	free(out.confs);
+	return NULL;
+}
+
+/**
+ * Writes the non-blank part of the tape of a configuration.
+ *
+ * @param c Configuration whose tape should be written.
+ * @param stream Stream to write the tape to.
+ */
+static void
+writeconf(ntmconf *c, FILE *stream)
+{
+	long pos, lo, hi;
+
+	lo = c->base;
+	hi = c->base + (long)(c->nchunks * NTMCHUNK) - 1;
+	while (lo <= hi && readcell(c, lo) == BLANKCHAR)
+		lo++;
+	while (hi >= lo && readcell(c, hi) == BLANKCHAR)
+		hi--;
+
+	for (pos = lo; pos <= hi; pos++)
+		putc(readcell(c, pos), stream);
+	putc('\n', stream);
+}
+
+/**
+ * Runs a nondeterministic machine on the given input. The machine
+ * accepts if any branch halts in an accepting state.
+ *
+ * @param tm Machine which should be run, states must not be marked
+ * 	as dead by ::markdead.
+ * @param input Input for the machine.
+ * @param limit Maximum depth of the configuration tree.
+ * @param nthreads Amount of threads.
+ * @param steps Pointer to store the depth of the accepting
+ * 	configuration or of the deepest explored level at.
+ * @param tape Stream the tape of the accepting configuration is
+ * 	written to or NULL.
+ * @returns Result of the run.
+ */
+ntmres
+runntm(dtm *tm, char *input, unsigned long limit, unsigned int nthreads,
+		unsigned long *steps, FILE *tape)
+{
+	unsigned int i;
+	long pos;
+	ntmres res;
+	ntmconf init;
+	ntmsearch *s;
+	pthread_t *thrs;
+
+	/* Like ::runtm the empty input doesn't perform any transition. */
+	if (!*input) {
+		*steps = 0;
+		if (tape)
+			putc('\n', tape);
+		return (isaccepting(tm, tm->start)) ? NTM_REJECT : NTM_ACCEPT;
+	}
+
+	s = emalloc(sizeof(ntmsearch));
+	memset(s, 0, sizeof(ntmsearch));
+	s->tm = tm;
+	s->limit = limit;
+	if ((errno = pthread_mutex_init(&s->lock, NULL)))
+		die("pthread_mutex_init failed");
+	for (i = 0; i < NTMSHARDS; i++)
+		if ((errno = pthread_mutex_init(&s->shards[i].lock, NULL)))
+			die("pthread_mutex_init failed");
+	if ((errno = pthread_barrier_init(&s->barrier, NULL, nthreads)))
+		die("pthread_barrier_init failed");
+
+	memset(&init, 0, sizeof(init));
+	init.state = tm->start;
+	for (pos = 0; input[pos]; pos++)
+		writecell(&init, pos, input[pos]);
+	(void)visit(s, confhash(&init));
+	pushconf(&s->cur, &init);
+
+	thrs = emalloc(nthreads * sizeof(pthread_t));
+	for (i = 0; i < nthreads; i++)
+		if ((errno = pthread_create(&thrs[i], NULL, ntmworker, s)))
+			die("pthread_create failed");
+	for (i = 0; i < nthreads; i++)
+		if ((errno = pthread_join(thrs[i], NULL)))
+			die("pthread_join failed");
+
+	*steps = s->depth;
+	if (s->accepted) {
+		res = NTM_ACCEPT;
+		if (tape)
+			writeconf(&s->accept, tape);
+		freeconf(&s->accept);
+	} else {
+		res = (s->cur.n) ? NTM_LIMIT : NTM_REJECT;
+	}
+
+	for (i = 0; i < s->cur.n; i++)
+		freeconf(&s->cur.confs[i]);
+	for (i = 0; i < NTMSHARDS; i++) {
+		free(s->shards[i].slots);
+		pthread_mutex_destroy(&s->shards[i].lock);
+	}
+	free(s->cur.confs);
+	free(s->next.confs);
+	pthread_barrier_destroy(&s->barrier);
+	pthread_mutex_destroy(&s->lock);
+	free(thrs);
+	free(s);
+	return res;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_NTM_H
+#define TMSIM_NTM_H
+
+#include <stdio.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Amount of cells per tape chunk. Configurations share chunks
+	 * and copy a chunk before writing to it if it is shared.
+	 */
+	NTMCHUNK = 64,
+
+	/**
+	 * Amount of independently locked shards of the visited set.
+	 * Must be a power of two.
+	 */
+	NTMSHARDS = 64,
+
+	/**
+	 * Amount of configurations claimed by a thread at once.
+	 */
+	NTMBATCH = 64,
+
+	/**
+	 * Default maximum depth of the configuration tree.
+	 */
+	NTMSTEPS = 1 << 16,
+};
+
+/**
+ * Result of running a nondeterministic machine.
+ */
+typedef enum {
+	NTM_ACCEPT, /**< A branch halted in an accepting state. */
+	NTM_REJECT, /**< All branches halted or revisited configurations. */
+	NTM_LIMIT,  /**< The maximum depth was reached undecided. */
+} ntmres;
+
+ntmres runntm(dtm *, char *, unsigned long, unsigned int,
+	unsigned long *, FILE *);
+
+#endif
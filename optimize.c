@@ -0,0 +1,1138 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+
+#include "optimize.h"
+#include "turing.h"
+#include "util.h"
+
+enum {
+	/**
+	 * Target class used by ::minimize for transitions into undefined
+	 * states which are not accepting.
+	 */
+	UNDEFREJECT = -1,
+
+	/**
+	 * Target class used by ::minimize for transitions into undefined
+	 * states which are accepting.
+	 */
+	UNDEFACCEPT = -2,
+
+	/**
+	 * Maximum amount of successor transitions fused with a single
+	 * transition by ::fuse. Prevents endless fusion of cycles.
+	 */
+	MAXFUSE = 16,
+};
+
+/**
+ * Array of all states of a turing machine sorted by name. Used to map
+ * state names to dense indices during the analysis passes.
+ */
+typedef struct _statevec statevec;
+
+struct _statevec {
+	tmstate **states; /**< Pointer to array of states. */
+	size_t len;       /**< Amount of states in the array. */
+};
+
+/**
+ * Context passed to the transition callbacks of ::markdead.
+ */
+typedef struct _deadctx deadctx;
+
+struct _deadctx {
+	dtm *tm;       /**< Turing machine which is analyzed. */
+	statevec *vec; /**< States of the turing machine. */
+	size_t src;    /**< Index of the state currently iterated over. */
+
+	/**
+	 * Offsets into the predecessor array. The predecessors of the
+	 * state at index i are stored in the range [off[i], off[i+1]).
+	 */
+	size_t *off;
+
+	size_t *fill;  /**< Next free slot for each predecessor range. */
+	size_t *preds; /**< Indices of predecessor states. */
+	int *alive;    /**< Whether an accepting state is reachable. */
+};
+
+/**
+ * Transition in the flattened representation used by ::minimize.
+ */
+typedef struct _mintrans mintrans;
+
+struct _mintrans {
+	tmtrans *trans; /**< Underlying transition. */
+
+	/**
+	 * Index of the target state in the state vector. If the target
+	 * state is undefined either UNDEFREJECT or UNDEFACCEPT is used.
+	 */
+	ssize_t target;
+};
+
+/**
+ * Context passed to the callbacks of ::minimize.
+ */
+typedef struct _minctx minctx;
+
+struct _minctx {
+	dtm *tm;       /**< Turing machine which is minimized. */
+	statevec *vec; /**< States of the turing machine. */
+	int keeptape;  /**< Whether the tape content must be retained. */
+	int keepsteps; /**< Whether the amount of steps must be retained. */
+
+	int *reach;    /**< Whether a state is reachable from the start. */
+	size_t *queue; /**< Queue of states whose successors are visited. */
+	size_t tail;   /**< Amount of states added to the queue. */
+
+	char drop[UCHAR_MAX + 1]; /**< Symbols of superfluous transitions. */
+	size_t ndrop;             /**< Amount of superfluous transitions. */
+
+	size_t *off;     /**< Offsets of the transitions of each state. */
+	mintrans *trans; /**< Flattened transitions of all states. */
+	size_t ntrans;   /**< Amount of flattened transitions. */
+	size_t *class;   /**< Current equivalence class of each state. */
+
+	/**
+	 * Smallest undefined rejecting (index 0) and accepting (index 1)
+	 * target state name or -1 if there is no such target state.
+	 */
+	tmname undef[2];
+};
+
+/**
+ * Edge of the state graph weighted by the amount of times it was
+ * taken, used by ::layout.
+ */
+typedef struct _hotedge hotedge;
+
+struct _hotedge {
+	size_t src;           /**< Index of the source state. */
+	size_t dst;           /**< Index of the target state. */
+	unsigned long weight; /**< Amount of times the edge was taken. */
+};
+
+/**
+ * Chain of states which should be placed adjacent in memory.
+ */
+typedef struct _hotchain hotchain;
+
+struct _hotchain {
+	size_t head;        /**< Index of the first state in the chain. */
+	unsigned long heat; /**< Sum of the heat of all states. */
+};
+
+/**
+ * Context passed to the callbacks of ::layout.
+ */
+typedef struct _layoutctx layoutctx;
+
+struct _layoutctx {
+	dtm *tm;       /**< Turing machine whose states are reordered. */
+	statevec *vec; /**< States of the turing machine. */
+	size_t src;    /**< Index of the state currently iterated over. */
+
+	/**
+	 * Amount of transitions performed from each state.
+	 */
+	unsigned long *heat;
+
+	hotedge *edges; /**< Edges between distinct states. */
+	size_t nedges;  /**< Amount of edges. */
+	size_t ecap;    /**< Amount of edges allocated. */
+};
+
+/**
+ * Context used by ::cmpsig since qsort(3) doesn't support passing one.
+ */
+static minctx *sortctx;
+
+/**
+ * Increments the counter pointed to by the given argument. Used to
+ * determine the amount of states of a turing machine.
+ *
+ * @param state Current state, unused.
+ * @param arg Void pointer to a size_t counter.
+ */
+static void
+countstate(tmstate *state, void *arg)
+{
+	(void)state;
+	(*(size_t *)arg)++;
+}
+
+/**
+ * Appends the given state to the state vector passed as argument.
+ *
+ * @param state State which should be appended.
+ * @param arg Void pointer to a ::statevec.
+ */
+static void
+appendstate(tmstate *state, void *arg)
+{
+	statevec *vec;
+
+	vec = arg;
+	vec->states[vec->len++] = state;
+}
+
+/**
+ * Compares two state pointers by state name, used for qsort(3).
+ *
+ * @param s1 Pointer to the first state pointer.
+ * @param s2 Pointer to the second state pointer.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmpstate(const void *s1, const void *s2)
+{
+	tmname n1, n2;
+
+	n1 = (*(tmstate *const *)s1)->name;
+	n2 = (*(tmstate *const *)s2)->name;
+
+	return (n1 > n2) - (n1 < n2);
+}
+
+/**
+ * Creates a vector of all states of the given turing machine sorted by
+ * state name.
+ *
+ * @param tm Turing machine whose states should be collected.
+ * @returns Pointer to the newly created state vector.
+ */
+static statevec *
+newstatevec(dtm *tm)
+{
+	size_t len;
+	statevec *vec;
+
+	len = 0;
+	eachstate(tm, countstate, &len);
+
+	vec = emalloc(sizeof(statevec));
+	vec->states = emalloc((len ? len : 1) * sizeof(tmstate *));
+	vec->len = 0;
+
+	eachstate(tm, appendstate, vec);
+	assert(vec->len == len);
+
+	qsort(vec->states, vec->len, sizeof(tmstate *), cmpstate);
+	return vec;
+}
+
+/**
+ * Frees all resources allocated for a state vector. The states
+ * themselves are not freed.
+ *
+ * @param vec State vector which should be freed.
+ */
+static void
+freestatevec(statevec *vec)
+{
+	free(vec->states);
+	free(vec);
+}
+
+/**
+ * Looks up the index of the state with the given name.
+ *
+ * @param vec State vector to search in.
+ * @param name Name of the state.
+ * @returns Index of the state or -1 if the state isn't defined.
+ */
+static ssize_t
+stateidx(statevec *vec, tmname name)
+{
+	size_t lo, hi, mid;
+	tmname cur;
+
+	lo = 0;
+	hi = vec->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		cur = vec->states[mid]->name;
+
+		if (cur == name)
+			return (ssize_t)mid;
+		else if (cur < name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return -1;
+}
+
+/**
+ * Compares two flattened transitions by the symbols triggering them,
+ * used for qsort(3).
+ *
+ * @param t1 Pointer to the first transition.
+ * @param t2 Pointer to the second transition.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmprsym(const void *t1, const void *t2)
+{
+	const tmtrans *a, *b;
+
+	a = ((const mintrans *)t1)->trans;
+	b = ((const mintrans *)t2)->trans;
+
+	if (a->rsym != b->rsym)
+		return a->rsym - b->rsym;
+	return memcmp(a->xrsym, b->xrsym, sizeof(a->xrsym));
+}
+
+/**
+ * Returns the equivalence class of the target state of the given
+ * flattened transition. Undefined target states have a negative class.
+ *
+ * @param ctx Context of the minimization.
+ * @param t Transition whose target class should be returned.
+ * @returns Class of the target state.
+ */
+static long
+targetclass(minctx *ctx, mintrans *t)
+{
+	if (t->target < 0)
+		return (long)t->target;
+
+	return (long)ctx->class[t->target];
+}
+
+/**
+ * Compares two states (identified by index) by their current class and
+ * their signature. The signature consists of the written symbol, the
+ * head direction and the class of the target state for each symbol
+ * the state has a transition for. Used for qsort(3).
+ *
+ * @param p1 Pointer to the index of the first state.
+ * @param p2 Pointer to the index of the second state.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmpsig(const void *p1, const void *p2)
+{
+	int r;
+	size_t i, j, k, n;
+	long c1, c2;
+	mintrans *t1, *t2;
+
+	i = *(const size_t *)p1;
+	j = *(const size_t *)p2;
+
+	if (sortctx->class[i] != sortctx->class[j])
+		return (sortctx->class[i] < sortctx->class[j]) ? -1 : 1;
+
+	n = sortctx->off[i + 1] - sortctx->off[i];
+	if (n != sortctx->off[j + 1] - sortctx->off[j])
+		return (n < sortctx->off[j + 1] - sortctx->off[j]) ? -1 : 1;
+
+	for (k = 0; k < n; k++) {
+		t1 = &sortctx->trans[sortctx->off[i] + k];
+		t2 = &sortctx->trans[sortctx->off[j] + k];
+
+		if (t1->trans->rsym != t2->trans->rsym)
+			return t1->trans->rsym - t2->trans->rsym;
+		if (t1->trans->wsym != t2->trans->wsym)
+			return t1->trans->wsym - t2->trans->wsym;
+		if (t1->trans->headdir != t2->trans->headdir)
+			return (t1->trans->headdir < t2->trans->headdir) ? -1 : 1;
+
+		/* Unused entries of single-tape machines are always equal. */
+		if ((r = memcmp(t1->trans->xrsym, t2->trans->xrsym,
+				sizeof(t1->trans->xrsym))) ||
+				(r = memcmp(t1->trans->xwsym, t2->trans->xwsym,
+				sizeof(t1->trans->xwsym))) ||
+				(r = memcmp(t1->trans->xdir, t2->trans->xdir,
+				sizeof(t1->trans->xdir))))
+			return r;
+		if (t1->trans->steps != t2->trans->steps)
+			return (t1->trans->steps < t2->trans->steps) ? -1 : 1;
+
+		c1 = targetclass(sortctx, t1);
+		c2 = targetclass(sortctx, t2);
+		if (c1 != c2)
+			return (c1 < c2) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Adds the target state of the given transition to the queue of
+ * reachable states if it wasn't reached before.
+ *
+ * @param trans Transition whose target should be visited.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::minctx.
+ */
+static void
+reachtrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	ssize_t idx;
+	minctx *ctx;
+
+	(void)state;
+	ctx = arg;
+
+	if ((idx = stateidx(ctx->vec, trans->nextstate)) == -1)
+		return;
+	if (ctx->reach[idx])
+		return;
+
+	ctx->reach[idx] = 1;
+	ctx->queue[ctx->tail++] = (size_t)idx;
+}
+
+/**
+ * Records the given transition as superfluous if it leads to an
+ * undefined state and can't affect the outcome of the computation.
+ * This is the case if halting in the undefined state yields the same
+ * result as halting in the current state. If the tape content must be
+ * retained the transition must additionally not modify the tape. If
+ * the amount of steps must be retained no transition is superfluous.
+ * Transitions of multi-tape machines are always retained.
+ *
+ * @param trans Transition which should be checked.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to a ::minctx.
+ */
+static void
+droptrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	minctx *ctx;
+
+	ctx = arg;
+
+	if (ctx->keepsteps || ctx->tm->ntapes > 1 ||
+	    stateidx(ctx->vec, trans->nextstate) != -1)
+		return;
+	if (isaccepting(ctx->tm, trans->nextstate) !=
+	    isaccepting(ctx->tm, state->name))
+		return;
+	if (ctx->keeptape &&
+	    (trans->wsym != trans->rsym || trans->headdir != STAY))
+		return;
+
+	ctx->drop[ctx->ndrop++] = trans->rsym;
+}
+
+/**
+ * Increments the amount of transitions stored in the given context.
+ *
+ * @param trans Current transition, unused.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::minctx.
+ */
+static void
+counttrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)trans;
+	(void)state;
+
+	((minctx *)arg)->ntrans++;
+}
+
+/**
+ * Appends the given transition to the flattened transitions.
+ *
+ * @param trans Transition which should be appended.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::minctx.
+ */
+static void
+flattrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	int acc;
+	tmname name;
+	minctx *ctx;
+	mintrans *t;
+
+	(void)state;
+	ctx = arg;
+	name = trans->nextstate;
+
+	t = &ctx->trans[ctx->ntrans++];
+	t->trans = trans;
+	if ((t->target = stateidx(ctx->vec, name)) != -1)
+		return;
+
+	acc = !isaccepting(ctx->tm, name);
+	t->target = (acc) ? UNDEFACCEPT : UNDEFREJECT;
+	if (ctx->undef[acc] == -1 || name < ctx->undef[acc])
+		ctx->undef[acc] = name;
+}
+
+/**
+ * Compares two edges by source and target state, used for qsort(3).
+ *
+ * @param e1 Pointer to the first edge.
+ * @param e2 Pointer to the second edge.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmpedge(const void *e1, const void *e2)
+{
+	const hotedge *a, *b;
+
+	a = e1;
+	b = e2;
+
+	if (a->src != b->src)
+		return (a->src < b->src) ? -1 : 1;
+	if (a->dst != b->dst)
+		return (a->dst < b->dst) ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Compares two edges by weight in descending order, ties are broken
+ * by source and target state. Used for qsort(3).
+ *
+ * @param e1 Pointer to the first edge.
+ * @param e2 Pointer to the second edge.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmpweight(const void *e1, const void *e2)
+{
+	const hotedge *a, *b;
+
+	a = e1;
+	b = e2;
+
+	if (a->weight != b->weight)
+		return (a->weight > b->weight) ? -1 : 1;
+
+	return cmpedge(e1, e2);
+}
+
+/**
+ * Compares two chains by heat in descending order, ties are broken by
+ * the index of the first state. Used for qsort(3).
+ *
+ * @param c1 Pointer to the first chain.
+ * @param c2 Pointer to the second chain.
+ * @returns An integer less than, equal to, or greater than zero.
+ */
+static int
+cmpchain(const void *c1, const void *c2)
+{
+	const hotchain *a, *b;
+
+	a = c1;
+	b = c2;
+
+	if (a->heat != b->heat)
+		return (a->heat > b->heat) ? -1 : 1;
+	if (a->head != b->head)
+		return (a->head < b->head) ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * Adds the amount of times the given transition was performed to the
+ * heat of its state and records it as an edge of the state graph.
+ *
+ * @param trans Transition which should be recorded.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::layoutctx.
+ */
+static void
+hottrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	size_t cap;
+	ssize_t dst;
+	layoutctx *ctx;
+	hotedge *edge;
+
+	(void)state;
+	ctx = arg;
+
+	if (!trans->count)
+		return;
+
+	ctx->heat[ctx->src] += trans->count;
+	dst = stateidx(ctx->vec, trans->nextstate);
+	if (dst == -1 || (size_t)dst == ctx->src)
+		return;
+
+	if (ctx->nedges == ctx->ecap) {
+		cap = (ctx->ecap) ? ctx->ecap * 2 : STATEMAPSIZ;
+		ctx->edges = tagrealloc(MEM_OTHER, ctx->edges,
+			ctx->ecap * sizeof(hotedge), cap * sizeof(hotedge));
+		ctx->ecap = cap;
+	}
+
+	edge = &ctx->edges[ctx->nedges++];
+	edge->src = ctx->src;
+	edge->dst = (size_t)dst;
+	edge->weight = trans->count;
+}
+
+/**
+ * Finds the representative of the chain containing the given state.
+ *
+ * @param set Union-find forest of chains.
+ * @param i Index of the state.
+ * @returns Index of the representative.
+ */
+static size_t
+findchain(size_t *set, size_t i)
+{
+	while (set[i] != i) {
+		set[i] = set[set[i]];
+		i = set[i];
+	}
+
+	return i;
+}
+
+/**
+ * Fuses the given transition with its successors as long as it doesn't
+ * move the head. In that case the symbol read by the next transition is
+ * the one written by the current transition and the next transition is
+ * thus fully determined by the current one.
+ *
+ * @param trans Transition which should be fused with its successors.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to the turing machine.
+ */
+static void
+fusetrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	size_t i;
+	char wsym;
+	direction headdir;
+	tmname nextstate;
+	unsigned long steps;
+	tmstate *next;
+	tmtrans *succ;
+
+	(void)state;
+
+	/* The successor may be the given transition itself, it
+	 * is therefore only modified once all successors are known. */
+	wsym = trans->wsym;
+	headdir = trans->headdir;
+	nextstate = trans->nextstate;
+	steps = trans->steps;
+
+	for (i = 0; i < MAXFUSE && headdir == STAY; i++) {
+		/* Entering a dead state ends the computation. */
+		if (getstate(arg, nextstate, &next) || next->dead)
+			break;
+		if (gettrans(next, wsym, &succ))
+			break;
+
+		wsym = succ->wsym;
+		headdir = succ->headdir;
+		nextstate = succ->nextstate;
+		steps += succ->steps;
+	}
+
+	trans->wsym = wsym;
+	trans->headdir = headdir;
+	trans->nextstate = nextstate;
+	trans->steps = steps;
+}
+
+/**
+ * Fuses all transitions of the given state with their successors.
+ *
+ * @param state State whose transitions should be fused.
+ * @param arg Void pointer to the turing machine.
+ */
+static void
+fusestate(tmstate *state, void *arg)
+{
+	eachtrans(state, fusetrans, arg);
+}
+
+/**
+ * Counts the given transition as an incoming edge of its target state.
+ * If the target state is an undefined accepting state the source state
+ * is marked as alive instead.
+ *
+ * @param trans Transition which should be counted.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::deadctx.
+ */
+static void
+countpred(tmtrans *trans, tmstate *state, void *arg)
+{
+	ssize_t idx;
+	deadctx *ctx;
+
+	(void)state;
+	ctx = arg;
+
+	if ((idx = stateidx(ctx->vec, trans->nextstate)) == -1) {
+		if (!isaccepting(ctx->tm, trans->nextstate))
+			ctx->alive[ctx->src] = 1;
+		return;
+	}
+
+	ctx->off[idx + 1]++;
+}
+
+/**
+ * Records the source state of the given transition as a predecessor of
+ * its target state.
+ *
+ * @param trans Transition which should be recorded.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to a ::deadctx.
+ */
+static void
+addpred(tmtrans *trans, tmstate *state, void *arg)
+{
+	ssize_t idx;
+	deadctx *ctx;
+
+	(void)state;
+	ctx = arg;
+
+	if ((idx = stateidx(ctx->vec, trans->nextstate)) == -1)
+		return;
+
+	ctx->preds[ctx->fill[idx]++] = ctx->src;
+}
+
+/**
+ * Marks all states of the given turing machine from which no accepting
+ * state is reachable as dead. Once the machine enters a dead state it
+ * can't accept the input anymore, the interpreter therefore rejects the
+ * input immediately when entering such a state.
+ *
+ * Since the computation is aborted early, the tape content differs from
+ * the one of a complete run. This pass should thus only be performed
+ * if the caller is solely interested in the result of the computation.
+ *
+ * @param tm Turing machine whose states should be analyzed.
+ */
+void
+markdead(dtm *tm)
+{
+	size_t i, j, n, head, tail, *queue;
+	deadctx ctx;
+
+	ctx.tm = tm;
+	ctx.vec = newstatevec(tm);
+	n = ctx.vec->len;
+
+	ctx.off = emalloc((n + 1) * sizeof(size_t));
+	ctx.fill = emalloc((n + 1) * sizeof(size_t));
+	ctx.alive = emalloc((n + 1) * sizeof(int));
+	queue = emalloc((n + 1) * sizeof(size_t));
+
+	for (i = 0; i <= n; i++) {
+		ctx.off[i] = 0;
+		ctx.alive[i] = 0;
+	}
+
+	for (ctx.src = 0; ctx.src < n; ctx.src++)
+		eachtrans(ctx.vec->states[ctx.src], countpred, &ctx);
+	for (i = 0; i < n; i++)
+		ctx.off[i + 1] += ctx.off[i];
+	for (i = 0; i <= n; i++)
+		ctx.fill[i] = ctx.off[i];
+
+	ctx.preds = emalloc((ctx.off[n] ? ctx.off[n] : 1) * sizeof(size_t));
+	for (ctx.src = 0; ctx.src < n; ctx.src++)
+		eachtrans(ctx.vec->states[ctx.src], addpred, &ctx);
+
+	head = tail = 0;
+	for (i = 0; i < n; i++) {
+		if (!isaccepting(tm, ctx.vec->states[i]->name))
+			ctx.alive[i] = 1;
+		if (ctx.alive[i])
+			queue[tail++] = i;
+	}
+
+	/* Breadth-first search on the reversed state graph. */
+	while (head < tail) {
+		i = queue[head++];
+		for (j = ctx.off[i]; j < ctx.off[i + 1]; j++) {
+			if (ctx.alive[ctx.preds[j]])
+				continue;
+
+			ctx.alive[ctx.preds[j]] = 1;
+			queue[tail++] = ctx.preds[j];
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		ctx.vec->states[i]->dead = !ctx.alive[i];
+
+	free(queue);
+	free(ctx.preds);
+	free(ctx.alive);
+	free(ctx.fill);
+	free(ctx.off);
+	freestatevec(ctx.vec);
+}
+
+/**
+ * Removes all states which are not reachable from the initial state.
+ *
+ * @param ctx Context of the minimization, the state vector is
+ * 	replaced with one containing only the remaining states.
+ */
+static void
+dropunreachable(minctx *ctx)
+{
+	size_t i, head, n;
+	ssize_t start;
+
+	n = ctx->vec->len;
+	ctx->reach = emalloc((n + 1) * sizeof(int));
+	ctx->queue = emalloc((n + 1) * sizeof(size_t));
+
+	for (i = 0; i < n; i++)
+		ctx->reach[i] = 0;
+
+	head = ctx->tail = 0;
+	if ((start = stateidx(ctx->vec, ctx->tm->start)) != -1) {
+		ctx->reach[start] = 1;
+		ctx->queue[ctx->tail++] = (size_t)start;
+	}
+
+	while (head < ctx->tail)
+		eachtrans(ctx->vec->states[ctx->queue[head++]], reachtrans, ctx);
+
+	for (i = 0; i < n; i++)
+		if (!ctx->reach[i])
+			delstate(ctx->tm, ctx->vec->states[i]->name);
+
+	free(ctx->queue);
+	free(ctx->reach);
+
+	freestatevec(ctx->vec);
+	ctx->vec = newstatevec(ctx->tm);
+}
+
+/**
+ * Partitions the states into classes of equivalent states using
+ * Moore's partition refinement algorithm. Initially states are only
+ * distinguished by acceptance, afterwards classes are split by the
+ * signature of their states until the partition doesn't change anymore.
+ *
+ * @param ctx Context of the minimization, the class field is
+ * 	initialized with the resulting equivalence class of each state.
+ * @returns Amount of equivalence classes.
+ */
+static size_t
+partition(minctx *ctx)
+{
+	size_t i, n, nclass, count, *order, *newclass, *tmp;
+	int acc[2];
+
+	n = ctx->vec->len;
+	ctx->class = emalloc((n + 1) * sizeof(size_t));
+	newclass = emalloc((n + 1) * sizeof(size_t));
+	order = emalloc((n + 1) * sizeof(size_t));
+
+	acc[0] = acc[1] = 0;
+	for (i = 0; i < n; i++) {
+		order[i] = i;
+		ctx->class[i] = !isaccepting(ctx->tm, ctx->vec->states[i]->name);
+		acc[ctx->class[i]] = 1;
+	}
+
+	nclass = (size_t)(acc[0] + acc[1]);
+	sortctx = ctx;
+
+	while (n > 0) {
+		qsort(order, n, sizeof(size_t), cmpsig);
+
+		count = 1;
+		newclass[order[0]] = 0;
+		for (i = 1; i < n; i++) {
+			if (cmpsig(&order[i - 1], &order[i]))
+				count++;
+			newclass[order[i]] = count - 1;
+		}
+
+		tmp = ctx->class;
+		ctx->class = newclass;
+		newclass = tmp;
+
+		/* Classes are only ever split, if the amount of
+		 * classes didn't change the partition is stable. */
+		if (count == nclass)
+			break;
+		nclass = count;
+	}
+
+	free(order);
+	free(newclass);
+	return nclass;
+}
+
+/**
+ * Minimizes the given turing machine. States which are not reachable
+ * from the initial state are removed, transitions into undefined states
+ * which can't affect the outcome of the computation are removed and
+ * equivalent states are merged into a single state.
+ *
+ * The result of the computation is never altered by this pass. The tape
+ * content and the amount of steps are only retained if requested since
+ * removing transitions into undefined states may alter them.
+ *
+ * @param tm Turing machine which should be minimized.
+ * @param keeptape Whether the tape content after running the minimized
+ * 	turing machine must be equal to the one of the original machine.
+ * @param keepsteps Whether the minimized turing machine must perform
+ * 	the same amount of steps as the original machine.
+ */
+void
+minimize(dtm *tm, int keeptape, int keepsteps)
+{
+	size_t i, j, k, n, nclass, *rep;
+	ssize_t start;
+	tmname name;
+	tmstate *state;
+	mintrans *t;
+	minctx ctx;
+
+	ctx.tm = tm;
+	ctx.keeptape = keeptape;
+	ctx.keepsteps = keepsteps;
+	ctx.vec = newstatevec(tm);
+	dropunreachable(&ctx);
+	n = ctx.vec->len;
+
+	for (i = 0; i < n; i++) {
+		ctx.ndrop = 0;
+		eachtrans(ctx.vec->states[i], droptrans, &ctx);
+		for (j = 0; j < ctx.ndrop; j++)
+			deltrans(ctx.vec->states[i], ctx.drop[j]);
+	}
+
+	ctx.ntrans = 0;
+	for (i = 0; i < n; i++)
+		eachtrans(ctx.vec->states[i], counttrans, &ctx);
+
+	ctx.off = emalloc((n + 1) * sizeof(size_t));
+	ctx.trans = emalloc((ctx.ntrans ? ctx.ntrans : 1) * sizeof(mintrans));
+	ctx.undef[0] = ctx.undef[1] = -1;
+
+	ctx.ntrans = 0;
+	for (i = 0; i < n; i++) {
+		ctx.off[i] = ctx.ntrans;
+		eachtrans(ctx.vec->states[i], flattrans, &ctx);
+		qsort(&ctx.trans[ctx.off[i]], ctx.ntrans - ctx.off[i],
+		      sizeof(mintrans), cmprsym);
+	}
+	ctx.off[n] = ctx.ntrans;
+
+	nclass = partition(&ctx);
+	rep = emalloc((nclass + 1) * sizeof(size_t));
+	for (i = 0; i < nclass; i++)
+		rep[i] = n;
+
+	/* The state vector is sorted by name, the state with the
+	 * smallest name is thus used as the class representative
+	 * unless the class contains the initial state. */
+	for (i = 0; i < n; i++)
+		if (rep[ctx.class[i]] == n)
+			rep[ctx.class[i]] = i;
+	if ((start = stateidx(ctx.vec, tm->start)) != -1)
+		rep[ctx.class[start]] = (size_t)start;
+
+	for (i = 0; i < n; i++) {
+		if (rep[ctx.class[i]] != i)
+			continue;
+
+		for (k = ctx.off[i]; k < ctx.off[i + 1]; k++) {
+			t = &ctx.trans[k];
+			if (t->target < 0)
+				name = ctx.undef[t->target == UNDEFACCEPT];
+			else
+				name = ctx.vec->states[rep[ctx.class[t->target]]]->name;
+			t->trans->nextstate = name;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		if (rep[ctx.class[i]] != i)
+			delstate(tm, ctx.vec->states[i]->name);
+
+	/* Remove accepting states which are no longer referenced. If
+	 * none remains the first one is retained since the input
+	 * format requires at least one accepting state. */
+	for (i = j = 0; i < tm->acceptsiz; i++) {
+		name = tm->accept[i];
+		if (getstate(tm, name, &state) && name != tm->start &&
+		    name != ctx.undef[1])
+			continue;
+		tm->accept[j++] = name;
+	}
+	if (j > 0)
+		tm->acceptsiz = j;
+	else if (tm->acceptsiz > 0)
+		tm->acceptsiz = 1;
+
+	free(rep);
+	free(ctx.class);
+	free(ctx.trans);
+	free(ctx.off);
+	freestatevec(ctx.vec);
+}
+
+/**
+ * Renames and reorders the states of the given turing machine based
+ * on a transition frequency profile, previously read into the count
+ * field of the transitions using ::readprofile.
+ *
+ * States are arranged in chains using the greedy algorithm described
+ * by Pettis and Hansen: edges between states are visited in order of
+ * decreasing frequency and the chain ending with the source state is
+ * joined with the chain beginning with the target state. Chains are
+ * afterwards ordered by heat and states are reallocated in this order.
+ * The hottest states are thus adjacent in memory. States keep their
+ * names, which are shown to the user and stored in checkpoints.
+ *
+ * The computation itself isn't altered by this pass.
+ *
+ * @param tm Turing machine whose states should be reordered.
+ */
+void
+layout(dtm *tm)
+{
+	size_t i, j, k, n, nchains, *set, *next, *prev, *order;
+	hotedge *edge;
+	hotchain *chains;
+	tmstate **states;
+	layoutctx ctx;
+
+	ctx.tm = tm;
+	ctx.vec = newstatevec(tm);
+	n = ctx.vec->len;
+
+	ctx.heat = emalloc((n + 1) * sizeof(unsigned long));
+	set = emalloc((n + 1) * sizeof(size_t));
+	next = emalloc((n + 1) * sizeof(size_t));
+	prev = emalloc((n + 1) * sizeof(size_t));
+
+	ctx.edges = NULL;
+	ctx.nedges = ctx.ecap = 0;
+
+	for (i = 0; i < n; i++) {
+		ctx.heat[i] = 0;
+		set[i] = i;
+		next[i] = prev[i] = n;
+	}
+
+	for (ctx.src = 0; ctx.src < n; ctx.src++)
+		eachtrans(ctx.vec->states[ctx.src], hottrans, &ctx);
+
+	/* Merge edges between the same states caused by
+	 * transitions for different symbols. */
+	qsort(ctx.edges, ctx.nedges, sizeof(hotedge), cmpedge);
+	for (i = j = 0; i < ctx.nedges; i++) {
+		if (j && !cmpedge(&ctx.edges[j - 1], &ctx.edges[i]))
+			ctx.edges[j - 1].weight += ctx.edges[i].weight;
+		else
+			ctx.edges[j++] = ctx.edges[i];
+	}
+	ctx.nedges = j;
+
+	qsort(ctx.edges, ctx.nedges, sizeof(hotedge), cmpweight);
+	for (i = 0; i < ctx.nedges; i++) {
+		edge = &ctx.edges[i];
+		if (next[edge->src] != n || prev[edge->dst] != n)
+			continue;
+		if (findchain(set, edge->src) == findchain(set, edge->dst))
+			continue;
+
+		next[edge->src] = edge->dst;
+		prev[edge->dst] = edge->src;
+		set[findchain(set, edge->dst)] = findchain(set, edge->src);
+	}
+
+	chains = emalloc((n + 1) * sizeof(hotchain));
+	for (i = nchains = 0; i < n; i++) {
+		if (prev[i] != n)
+			continue;
+
+		chains[nchains].head = i;
+		chains[nchains].heat = 0;
+		for (j = i; j != n; j = next[j])
+			chains[nchains].heat += ctx.heat[j];
+		nchains++;
+	}
+	qsort(chains, nchains, sizeof(hotchain), cmpchain);
+
+	order = set; /* Union-find forest is no longer needed. */
+	for (i = k = 0; i < nchains; i++)
+		for (j = chains[i].head; j != n; j = next[j])
+			order[k++] = j;
+	assert(k == n);
+
+	states = emalloc((n + 1) * sizeof(tmstate *));
+	for (i = 0; i < n; i++)
+		states[i] = ctx.vec->states[order[i]];
+	relocstates(tm, states, n);
+
+	free(states);
+	free(chains);
+	free(prev);
+	free(next);
+	free(set);
+	free(ctx.edges);
+	free(ctx.heat);
+	freestatevec(ctx.vec);
+}
+
+/**
+ * Fuses chains of transitions where each transition is fully determined
+ * by its predecessor into a single compound transition. This is the
+ * case for transitions which don't move the head, since the symbol read
+ * by the following transition is the one written by the former.
+ *
+ * A compound transition performs the write and head movement of the
+ * last transition in the chain and advances the step counter by the
+ * length of the chain. Results and step counts are therefore equal to
+ * the ones of the unfused turing machine. Chains are not fused across
+ * dead states, this pass must thus be performed after ::markdead.
+ * Multi-tape machines are left unchanged.
+ *
+ * @param tm Turing machine whose transitions should be fused.
+ */
+void
+fuse(dtm *tm)
+{
+	if (tm->ntapes == 1)
+		eachstate(tm, fusestate, tm);
+}
@@ -17,13 +17,17 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <sys/mman.h>
 #include <sys/types.h>
 
 #include "parser.h"
 #include "scanner.h"
+#include "tape.h"
 #include "token.h"
 #include "turing.h"
 #include "util.h"
@@ -96,9 +100,12 @@ newparser(char *str, size_t len)
 {
 	parser *par;
 
-	par = emalloc(sizeof(parser));
+	par = tagalloc(MEM_PARSER, sizeof(parser));
 	par->scr = scanstr(str, len);
 	par->peektok = par->prevtok = par->tok = NULL;
+	par->nondet = 0;
+	par->maxtapes = 1;
+	par->ntapes = 0;
 	return par;
 }
 
@@ -218,6 +225,17 @@ strparerr(parser *par, parerr err, char *fn, FILE *stream)
 		msg = "Your transition is missing a state to transit to "
 		      "when performing this transition.";
 		break;
+	case PAR_TAPELIMIT:
+		msg = "Your transition uses more tapes than supported. "
+		      "Multi-tape machines can use up to four tapes but "
+		      "are not supported in all modes.";
+		break;
+	case PAR_TAPECOUNT:
+		msg = "Your transition doesn't match the amount of tapes. "
+		      "Each transition needs a symbol to read, a direction "
+		      "and a symbol to write for every tape and all "
+		      "transitions must use the same amount of tapes.";
+		break;
 	case PAR_OK:
 		/* Never reached */
 		break;
@@ -311,46 +329,145 @@ parsemeta(parser *par, dtm *dest)
 }
 
 /**
- * Parses a state transition of a tmsim input file.
+ * Parses a tuple of tape symbols of a tmsim input file, one symbol
+ * for each tape. Parsing stops after the given amount of symbols.
+ *
+ * The following EBNF rules describes valid input:
+ *
+ * \code
+ * symbols = symbol, { ",", symbol };
+ * \endcode
+ *
+ * @param par Parser for which a symbol tuple should be parsed.
+ * @param syms Array the symbols are stored in.
+ * @param max Maximum amount of symbols.
+ * @param n Pointer to store the amount of symbols at.
+ * @param err Error code returned if a symbol is missing.
+ * @return Error code or PAR_OK if no error was encountered.
+ */
+static parerr
+parsesyms(parser *par, char *syms, size_t max, size_t *n, parerr err)
+{
+	size_t i;
+
+	for (i = 0;; i++) {
+		par->tok = next(par);
+		if (par->tok->type != TOK_SYMBOL)
+			return err;
+		syms[i] = (char)par->tok->value;
+
+		if (i + 1 == max || peek(par)->type != TOK_COMMA)
+			break;
+		par->tok = next(par);
+	}
+
+	*n = i + 1;
+	return PAR_OK;
+}
+
+/**
+ * Parses a tuple of head directions of a tmsim input file.
  *
  * The following EBNF rules describes valid input:
  *
  * \code
- * transition = symbol, direction, symbol, "=>", statename;
+ * directions = direction, { ",", direction };
+ * \endcode
+ *
+ * @param par Parser for which a direction tuple should be parsed.
+ * @param dirs Array the directions are stored in.
+ * @param n Amount of directions, the amount of tapes.
+ * @return Error code or PAR_OK if no error was encountered.
+ */
+static parerr
+parsedirs(parser *par, direction *dirs, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (i) {
+			par->tok = next(par);
+			if (par->tok->type != TOK_COMMA)
+				return PAR_TAPECOUNT;
+		}
+
+		par->tok = next(par);
+		switch (par->tok->type) {
+		case TOK_SMALLER:
+			dirs[i] = LEFT;
+			break;
+		case TOK_GREATER:
+			dirs[i] = RIGHT;
+			break;
+		case TOK_PIPE:
+			dirs[i] = STAY;
+			break;
+		default:
+			return PAR_DIRECTION;
+		}
+	}
+
+	if (peek(par)->type == TOK_COMMA) {
+		par->tok = next(par);
+		return PAR_TAPECOUNT;
+	}
+
+	return PAR_OK;
+}
+
+/**
+ * Parses a state transition of a tmsim input file. A transition of a
+ * multi-tape machine specifies a tuple of symbols to read, a tuple of
+ * directions and a tuple of symbols to write, each with one element
+ * per tape. All transitions must use the same amount of tapes.
+ *
+ * The following EBNF rules describes valid input:
+ *
+ * \code
+ * transition = symbols, directions, symbols, "=>", statename;
  * \endcode
  *
  * @param par Parser for which a transition should be parsed.
- * @param dest Pointer to a transition, if the transition was parsed
- * 	successfully, the struct fields are initialized accordingly.
+ * @param dest Pointer to a transition created by ::newtrans, if the
+ * 	transition was parsed successfully, the struct fields are
+ * 	initialized accordingly.
  * @return Error code or PAR_OK if no error was encountered.
  */
 static parerr
 parsetrans(parser *par, tmtrans *dest)
 {
-	par->tok = next(par);
-	if (par->tok->type != TOK_SYMBOL)
-		return PAR_RSYMBOL;
-	dest->rsym = (char)par->tok->value;
+	size_t i, n, m;
+	char rsyms[TMMAXTAPES], wsyms[TMMAXTAPES];
+	direction dirs[TMMAXTAPES];
+	parerr ret;
 
-	par->tok = next(par);
-	switch (par->tok->type) {
-	case TOK_SMALLER:
-		dest->headdir = LEFT;
-		break;
-	case TOK_GREATER:
-		dest->headdir = RIGHT;
-		break;
-	case TOK_PIPE:
-		dest->headdir = STAY;
-		break;
-	default:
-		return PAR_DIRECTION;
+	if ((ret = parsesyms(par, rsyms, par->maxtapes, &n,
+			PAR_RSYMBOL)) != PAR_OK)
+		return ret;
+	if (peek(par)->type == TOK_COMMA) {
+		par->tok = next(par);
+		return PAR_TAPELIMIT;
+	} else if (par->ntapes && n != par->ntapes) {
+		return PAR_TAPECOUNT;
 	}
+	par->ntapes = n;
 
-	par->tok = next(par);
-	if (par->tok->type != TOK_SYMBOL)
-		return PAR_WSYMBOL;
-	dest->wsym = (char)par->tok->value;
+	if ((ret = parsedirs(par, dirs, n)) != PAR_OK)
+		return ret;
+	if ((ret = parsesyms(par, wsyms, n, &m, PAR_WSYMBOL)) != PAR_OK)
+		return ret;
+	if (m != n)
+		return PAR_TAPECOUNT;
+
+	dest->rsym = rsyms[0];
+	dest->wsym = wsyms[0];
+	dest->headdir = dirs[0];
+
+	for (i = 1; i < n; i++) {
+		dest->xrsym[i - 1] = rsyms[i];
+		dest->xwsym[i - 1] = wsyms[i];
+		dest->xdir[i - 1] = dirs[i];
+	}
 
 	par->tok = next(par);
 	if (par->tok->type != TOK_NEXT)
@@ -381,7 +498,7 @@ parsetrans(parser *par, tmtrans *dest)
 static parerr
 parsestate(parser *par, tmstate *dest)
 {
-	tmtrans *trans;
+	tmtrans *trans, *prev;
 	parerr ret;
 
 	par->tok = next(par);
@@ -394,15 +511,23 @@ parsestate(parser *par, tmstate *dest)
 		return PAR_LBRACKET;
 
 	while (peek(par)->type != TOK_RBRACKET) {
-		trans = emalloc(sizeof(tmtrans));
+		trans = newtrans();
 		if ((ret = parsetrans(par, trans)) != PAR_OK) {
 			free(trans);
 			return ret;
 		}
 
 		if (addtrans(dest, trans)) {
-			free(trans);
-			return PAR_TRANSDEFTWICE;
+			if (!par->nondet) {
+				free(trans);
+				return PAR_TRANSDEFTWICE;
+			}
+
+			/* Keep alternatives in the order of definition. */
+			(void)gettrans(dest, trans->rsym, &prev);
+			while (prev->alt)
+				prev = prev->alt;
+			prev->alt = trans;
 		}
 
 		par->tok = next(par);
@@ -416,6 +541,34 @@ parsestate(parser *par, tmstate *dest)
 	return PAR_OK;
 }
 
+/**
+ * Adds the symbols of the given transition to the tape alphabet of
+ * the turing machine passed as argument.
+ *
+ * @param trans Transition whose symbols should be added.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to the turing machine.
+ */
+static void
+addsyms(tmtrans *trans, tmstate *state, void *arg)
+{
+	size_t i;
+	dtm *tm;
+
+	(void)state;
+	tm = arg;
+
+	for (; trans; trans = trans->alt) {
+		addsym(tm->tape, trans->rsym);
+		addsym(tm->tape, trans->wsym);
+
+		for (i = 0; i + 1 < tm->ntapes; i++) {
+			addsym(tm->xtape[i], trans->xrsym[i]);
+			addsym(tm->xtape[i], trans->xwsym[i]);
+		}
+	}
+}
+
 /**
  * Parses a series of state definitions of a tmsim input file.
  *
@@ -447,6 +600,11 @@ parsestates(parser *par, dtm *dest)
 			free(state);
 			return PAR_STATEDEFTWICE;
 		}
+
+		/* The tape alphabet is determined by the transitions. */
+		if (par->ntapes > dest->ntapes)
+			settapes(dest, par->ntapes);
+		eachtrans(state, addsyms, dest);
 	}
 
 	/* skip and free EOF */
@@ -482,3 +640,40 @@ parsetm(parser *par, dtm *dest)
 
 	return PAR_OK;
 }
+
+/**
+ * Reads and parses the given machine file using a parser with the
+ * default settings.
+ *
+ * @param path Path of the machine file.
+ * @returns Parsed machine or NULL if the file couldn't be read or
+ * 	parsed. An error message is written to stderr in that case.
+ */
+dtm *
+loadtm(char *path)
+{
+	char *fc;
+	ssize_t len;
+	parser *par;
+	parerr ret;
+	dtm *tm;
+
+	fc = NULL;
+	if ((len = readfile(&fc, path)) == -1) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	tm = newtm();
+	par = newparser(fc, (size_t)len);
+	if ((ret = parsetm(par, tm)) != PAR_OK) {
+		strparerr(par, ret, path, stderr);
+		freetm(tm);
+		tm = NULL;
+	}
+	freeparser(par);
+
+	if (len)
+		munmap(fc, (size_t)len);
+	return tm;
+}
@@ -54,6 +54,24 @@ struct _parser {
 	 * Underlying scanner for this parser.
 	 */
 	scanner *scr;
+
+	/**
+	 * Whether a state may have multiple transitions for the same
+	 * symbol. Additional transitions are stored as alternatives.
+	 */
+	int nondet;
+
+	/**
+	 * Maximum amount of tapes a transition may use, at most
+	 * TMMAXTAPES. Defaults to one.
+	 */
+	size_t maxtapes;
+
+	/**
+	 * Amount of tapes used by the transitions parsed so far or zero
+	 * if no transition was parsed yet.
+	 */
+	size_t ntapes;
 };
 
 /**
@@ -82,11 +100,15 @@ typedef enum {
 	PAR_WSYMBOL,      /**< Expected symbol to write after transition. */
 	PAR_NEXTSTATESYM, /**< Expected '=>' symbol. */
 	PAR_NEXTSTATE,    /**< Expected name of new state. */
+
+	PAR_TAPELIMIT, /**< Transition uses too many tapes. */
+	PAR_TAPECOUNT, /**< Transitions use different amounts of tapes. */
 } parerr;
 
 parser *newparser(char *, size_t);
 parerr parsetm(parser *, dtm *);
 void freeparser(parser *);
 int strparerr(parser *, parerr, char *, FILE *);
+dtm *loadtm(char *);
 
 #endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/* syscall(2) isn't part of POSIX. */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "perf.h"
+
+/**
+ * Names of the counters in the order they are stored in a perfctrs.
+ */
+static const char *ctrnames[NPERFCTR] = {
+	"cycles",
+	"instructions",
+	"branches",
+	"branch-misses",
+	"cache-references",
+	"cache-misses",
+	"task-clock",
+};
+
+#ifdef __linux__
+/**
+ * Type and configuration of the events corresponding to ctrnames. The
+ * task clock is a software event and thus also available if the
+ * hardware counters aren't, e.g. in virtual machines.
+ */
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} ctrevents[NPERFCTR] = {
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+#endif
+
+/**
+ * Opens all performance counters for the calling thread. Threads
+ * created afterwards inherit the counters, their events are thus
+ * included in the values read by ::perfstop. Forked processes, e.g.
+ * the one writing a checkpoint, don't inherit them. Kernels older than
+ * Linux 5.13 can't distinguish both, forked processes are counted as
+ * well on these. Only user space is
+ * measured, this is permitted by the default kernel configuration.
+ * Counters which can't be opened are skipped.
+ *
+ * @param p Counters which should be opened.
+ */
+void
+perfopen(perfctrs *p)
+{
+	size_t i;
+#ifdef __linux__
+	long fd;
+	struct perf_event_attr attr;
+#endif
+
+	p->err = 0;
+	for (i = 0; i < NPERFCTR; i++) {
+		p->fd[i] = -1;
+		p->val[i] = 0;
+		p->counted[i] = 0;
+
+#ifdef __linux__
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = ctrevents[i].type;
+		attr.config = ctrevents[i].config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.inherit = 1;
+		attr.inherit_thread = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		/* Older kernels reject the unknown inherit_thread bit. */
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd == -1 && errno == EINVAL) {
+			attr.inherit_thread = 0;
+			fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+
+		if (fd != -1)
+			p->fd[i] = (int)fd;
+		else if (!p->err)
+			p->err = errno;
+#else
+		p->err = ENOSYS;
+#endif
+	}
+}
+
+/**
+ * Resets and enables all opened counters.
+ *
+ * @param p Counters which should be started.
+ */
+void
+perfstart(perfctrs *p)
+{
+#ifdef __linux__
+	size_t i;
+
+	for (i = 0; i < NPERFCTR; i++) {
+		if (p->fd[i] == -1)
+			continue;
+		ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#else
+	(void)p;
+#endif
+}
+
+/**
+ * Disables all opened counters and reads their values. If the kernel
+ * multiplexed the counters the values are scaled accordingly.
+ *
+ * @param p Counters which should be stopped.
+ */
+void
+perfstop(perfctrs *p)
+{
+#ifdef __linux__
+	size_t i;
+	uint64_t buf[3]; /* value, time enabled, time running */
+
+	for (i = 0; i < NPERFCTR; i++) {
+		if (p->fd[i] != -1)
+			ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (i = 0; i < NPERFCTR; i++) {
+		p->counted[i] = 0;
+		if (p->fd[i] == -1 || read(p->fd[i], buf, sizeof(buf)) !=
+				sizeof(buf) || !buf[2])
+			continue;
+
+		p->val[i] = (buf[2] == buf[1]) ? buf[0] : (uint64_t)
+			((long double)buf[0] * buf[1] / buf[2]);
+		p->counted[i] = 1;
+	}
+#else
+	(void)p;
+#endif
+}
+
+/**
+ * Writes the values of all counters read by ::perfstop to the given
+ * stream, including ratios per step of the turing machine.
+ *
+ * @param p Counters which should be reported.
+ * @param phase Name of the measured phase.
+ * @param steps Amount of steps performed during the phase or zero if
+ * 	no ratios should be reported.
+ * @param stream Stream to write the report to.
+ */
+void
+perfreport(perfctrs *p, char *phase, unsigned long steps, FILE *stream)
+{
+	size_t i;
+
+	fprintf(stream, "# perf %s\n", phase);
+	for (i = 0; i < NPERFCTR; i++) {
+		if (!p->counted[i]) {
+			fprintf(stream, "%s unavailable\n", ctrnames[i]);
+			continue;
+		}
+
+		fprintf(stream, "%s %" PRIu64, ctrnames[i], p->val[i]);
+		if (steps)
+			fprintf(stream, " %.3f/step",
+				(double)p->val[i] / (double)steps);
+		fputc('\n', stream);
+	}
+
+	if (p->counted[0] && p->counted[1] && p->val[0])
+		fprintf(stream, "ipc %.3f\n",
+			(double)p->val[1] / (double)p->val[0]);
+	if (p->err)
+		fprintf(stream, "# some counters couldn't be opened: %s\n",
+			strerror(p->err));
+}
+
+/**
+ * Closes all opened counters.
+ *
+ * @param p Counters which should be closed.
+ */
+void
+perfclose(perfctrs *p)
+{
+	size_t i;
+
+	for (i = 0; i < NPERFCTR; i++) {
+		if (p->fd[i] != -1)
+			close(p->fd[i]);
+		p->fd[i] = -1;
+	}
+}
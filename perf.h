@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_PERF_H
+#define TMSIM_PERF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+	/**
+	 * Amount of performance counters, see ::perfopen.
+	 */
+	NPERFCTR = 7,
+};
+
+/**
+ * Set of performance counters. Counters which couldn't be
+ * opened, e.g. because the kernel forbids access, are skipped.
+ */
+typedef struct _perfctrs perfctrs;
+
+struct _perfctrs {
+	int fd[NPERFCTR];       /**< File descriptor of each counter or -1. */
+	uint64_t val[NPERFCTR]; /**< Value of each counter. */
+	int counted[NPERFCTR];  /**< Whether the counter was scheduled. */
+	int err;                /**< errno of the first failed counter. */
+};
+
+void perfopen(perfctrs *);
+void perfstart(perfctrs *);
+void perfstop(perfctrs *);
+void perfreport(perfctrs *, char *, unsigned long, FILE *);
+void perfclose(perfctrs *);
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+
+#include "profile.h"
+#include "turing.h"
+
+/**
+ * Writes the profile entry for a given transition to a given stream.
+ * Transitions which were never performed are omitted.
+ *
+ * @param trans Transition to write the profile entry for.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to a stream the output should be written to.
+ */
+static void
+profiletrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	if (trans->count)
+		fprintf(arg, "q%d %c %lu\n", state->name, trans->rsym,
+		        trans->count);
+}
+
+/**
+ * Writes the profile entries for all transitions of a given state
+ * to a given stream.
+ *
+ * @param state State to write profile entries for.
+ * @param arg Void pointer to a stream the output should be written to.
+ */
+static void
+profilestate(tmstate *state, void *arg)
+{
+	eachtrans(state, profiletrans, arg);
+}
+
+/**
+ * Writes the transition frequency profile of a given turing machine
+ * to a given stream. Each line of the profile consists of a state
+ * name, the symbol triggering the transition and the amount of times
+ * the transition was performed, separated by a single space.
+ *
+ * @param tm Turing machine whose profile should be written.
+ * @param stream Stream to write the profile to.
+ */
+void
+writeprofile(dtm *tm, FILE *stream)
+{
+	eachstate(tm, profilestate, stream);
+}
+
+/**
+ * Reads a transition frequency profile, as written by ::writeprofile,
+ * from a given stream and adds the counts to the transitions of the
+ * given turing machine. Entries for transitions which don't exist are
+ * ignored.
+ *
+ * @param tm Turing machine whose transitions should be updated.
+ * @param stream Stream to read the profile from.
+ * @returns -1 if the profile is malformed, 0 otherwise.
+ */
+int
+readprofile(dtm *tm, FILE *stream)
+{
+	int ret;
+	char rsym;
+	tmname name;
+	unsigned long count;
+	tmstate *state;
+	tmtrans *trans;
+
+	while ((ret = fscanf(stream, " q%d %c %lu", &name, &rsym,
+	                     &count)) == 3) {
+		if (getstate(tm, name, &state) ||
+		    gettrans(state, rsym, &trans))
+			continue;
+		trans->count += count;
+	}
+
+	return (ret == EOF && !ferror(stream)) ? 0 : -1;
+}
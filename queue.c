@@ -36,7 +36,7 @@ newqueue(void)
 {
 	queue *qu;
 
-	qu = emalloc(sizeof(queue));
+	qu = tagalloc(MEM_PARSER, sizeof(queue));
 	qu->head = qu->tail = 0;
 
 	if ((errno = pthread_mutex_init(&qu->hmtx, NULL)) ||
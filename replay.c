@@ -0,0 +1,148 @@
+/*
+ * Copyright © 2016-2018 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+
+#include "tape.h"
+#include "trace.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Writes the usage string for this program to stderr and terminates
+ * the programm with EXIT_FAILURE.
+ */
+static void
+usage(char *prog)
+{
+	fprintf(stderr, "USAGE: %s %s\n", prog,
+		"[-s first] [-e last] [-q state] [-t step] [-h|-v] TRACE");
+
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Parses a step number passed as an option argument and terminates
+ * the program if it isn't a valid number.
+ *
+ * @param prog Name of this program.
+ * @param arg Option argument which should be parsed.
+ * @returns Parsed step number.
+ */
+static unsigned long
+steparg(char *prog, char *arg)
+{
+	char *end;
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(arg, &end, 10);
+	if (errno || *end || !*arg || *arg == '-')
+		usage(prog);
+
+	return val;
+}
+
+/**
+ * The main function invoked when the program is started.
+ *
+ * @param argc Amount of command line parameters.
+ * @param argv Command line parameters.
+ */
+int
+main(int argc, char **argv)
+{
+	int opt, filter, tapeout;
+	unsigned long first, last, at;
+	tmname name, from;
+	tmreplay *r;
+	tmtrans *trans;
+	FILE *tfd;
+
+	first = 0;
+	last = at = ULONG_MAX;
+	name = filter = tapeout = 0;
+	while ((opt = getopt(argc, argv, "s:e:q:t:hv")) != -1) {
+		switch (opt) {
+		case 's':
+			first = steparg(argv[0], optarg);
+			break;
+		case 'e':
+			last = steparg(argv[0], optarg);
+			break;
+		case 'q':
+			if (sscanf(optarg, "q%d", &name) != 1)
+				usage(argv[0]);
+			filter = 1;
+			break;
+		case 't':
+			at = steparg(argv[0], optarg);
+			tapeout = 1;
+			break;
+		case 'v':
+			fprintf(stderr, "tmsim-"VERSION"\n");
+			return EXIT_FAILURE;
+		case 'h':
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (argc <= 1 || optind >= argc)
+		usage(argv[0]);
+
+	if (!(tfd = fopen(argv[optind], "r")))
+		die("couldn't open trace");
+	if (!(r = openreplay(tfd))) {
+		fprintf(stderr, "%s: Malformed trace.\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	/* Each record is printed with the step count reached after
+	 * performing the recorded transition. */
+	while ((!tapeout || r->step < at) && !replaystep(r, &trans, &from)) {
+		if (tapeout || r->step < first || r->step > last ||
+				(filter && from != name))
+			continue;
+		printf("%lu q%d { %c %c %c => q%d; }\n", r->step, from,
+			trans->rsym, dirsym(trans->headdir), trans->wsym,
+			trans->nextstate);
+	}
+
+	if (r->err) {
+		fprintf(stderr, "%s: Malformed trace record after step %lu.\n",
+			argv[optind], r->step);
+		return EXIT_FAILURE;
+	}
+
+	if (tapeout) {
+		printcells(r->tape, stdout);
+		printf("\nq%d %zu\n", r->state, r->tape->head - r->tape->lo);
+	}
+
+	freereplay(r);
+	fclose(tfd);
+
+	return EXIT_SUCCESS;
+}
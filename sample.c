@@ -0,0 +1,331 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "sample.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * State of a turing machine at the time it was sampled.
+ */
+typedef struct _sample sample;
+
+struct _sample {
+	tmname state; /**< Name of the current state. */
+	size_t head;  /**< Offset of the head from the leftmost cell. */
+};
+
+/**
+ * Amount of samples per state, used for the histogram.
+ */
+typedef struct _statecount statecount;
+
+struct _statecount {
+	tmname state;        /**< Name of the state. */
+	unsigned long count; /**< Amount of samples. */
+};
+
+/**
+ * Turing machine which is currently being sampled.
+ */
+static dtm *sampled;
+
+/**
+ * Buffer for the recorded samples. Only written by the signal handler
+ * and only read once sampling stopped, no locking is required.
+ */
+static sample *samples;
+
+/**
+ * Amount of samples recorded so far.
+ */
+static volatile sig_atomic_t nsamples;
+
+/**
+ * Amount of samples dropped because the buffer was full.
+ */
+static volatile sig_atomic_t ndropped;
+
+/**
+ * Signal handler for SIGPROF recording a single sample.
+ *
+ * @param signo Number of the received signal.
+ */
+static void
+handler(int signo)
+{
+	sample *s;
+
+	(void)signo;
+
+	if (nsamples >= MAXSAMPLES) {
+		ndropped++;
+		return;
+	}
+
+	s = &samples[nsamples];
+	s->state = sampled->cur;
+	s->head = (size_t)sampled->curhead;
+	nsamples++;
+}
+
+/**
+ * Starts sampling the current state and head position of the given
+ * turing machine with the given frequency. The frequency refers to
+ * consumed CPU time, not wall-clock time.
+ *
+ * @param tm Turing machine which should be sampled.
+ * @param hz Amount of samples per second.
+ */
+void
+startsampling(dtm *tm, unsigned long hz)
+{
+	struct sigaction act;
+	struct itimerval val;
+
+	sampled = tm;
+	samples = emalloc(MAXSAMPLES * sizeof(sample));
+	nsamples = ndropped = 0;
+
+	memset(&act, 0, sizeof(act));
+	act.sa_handler = handler;
+	act.sa_flags = SA_RESTART;
+	sigemptyset(&act.sa_mask);
+	if (sigaction(SIGPROF, &act, NULL))
+		die("sigaction failed");
+
+	val.it_interval.tv_sec = (time_t)(1 / hz);
+	val.it_interval.tv_usec = (suseconds_t)((hz > 1) ? 1000000 / hz : 0);
+	val.it_value = val.it_interval;
+	if (setitimer(ITIMER_PROF, &val, NULL))
+		die("setitimer failed");
+}
+
+/**
+ * Stops sampling started by ::startsampling.
+ */
+void
+stopsampling(void)
+{
+	struct itimerval val;
+
+	memset(&val, 0, sizeof(val));
+	if (setitimer(ITIMER_PROF, &val, NULL))
+		die("setitimer failed");
+	signal(SIGPROF, SIG_IGN);
+}
+
+/**
+ * Compares two state sample counts by descending amount of samples.
+ * Ties are broken by state name.
+ *
+ * @param a Pointer to the first statecount.
+ * @param b Pointer to the second statecount.
+ * @returns Integer less than, equal to or greater than zero.
+ */
+static int
+cmpcount(const void *a, const void *b)
+{
+	const statecount *x, *y;
+
+	x = a;
+	y = b;
+	if (x->count != y->count)
+		return (x->count > y->count) ? -1 : 1;
+	return (x->state > y->state) - (x->state < y->state);
+}
+
+/**
+ * Compares two samples by state name.
+ *
+ * @param a Pointer to the first sample.
+ * @param b Pointer to the second sample.
+ * @returns Integer less than, equal to or greater than zero.
+ */
+static int
+cmpstate(const void *a, const void *b)
+{
+	const sample *x, *y;
+
+	x = a;
+	y = b;
+	return (x->state > y->state) - (x->state < y->state);
+}
+
+/**
+ * Compares two folded stacks of FOLDDEPTH state names element-wise.
+ *
+ * @param a Pointer to the first stack.
+ * @param b Pointer to the second stack.
+ * @returns Integer less than, equal to or greater than zero.
+ */
+static int
+cmpstack(const void *a, const void *b)
+{
+	size_t i;
+	const tmname *x, *y;
+
+	x = a;
+	y = b;
+	for (i = 0; i < FOLDDEPTH; i++) {
+		if (x[i] != y[i])
+			return (x[i] > y[i]) ? 1 : -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Writes a histogram of the sampled states, sorted by descending
+ * amount of samples.
+ *
+ * @param stream Stream to write the histogram to.
+ * @param n Amount of recorded samples.
+ */
+static void
+writehisto(FILE *stream, size_t n)
+{
+	size_t i, j, ncounts;
+	sample *sorted;
+	statecount *counts;
+
+	sorted = emalloc(n * sizeof(sample));
+	memcpy(sorted, samples, n * sizeof(sample));
+	qsort(sorted, n, sizeof(sample), cmpstate);
+
+	counts = emalloc(n * sizeof(statecount));
+	for (i = ncounts = 0; i < n; i = j) {
+		for (j = i; j < n && sorted[j].state == sorted[i].state; j++)
+			;
+		counts[ncounts].state = sorted[i].state;
+		counts[ncounts++].count = j - i;
+	}
+	qsort(counts, ncounts, sizeof(statecount), cmpcount);
+
+	fprintf(stream, "# state samples percent\n");
+	for (i = 0; i < ncounts; i++)
+		fprintf(stream, "q%d %lu %.2f%%\n", counts[i].state,
+			counts[i].count, 100.0 * (double)counts[i].count /
+			(double)n);
+
+	free(counts);
+	free(sorted);
+}
+
+/**
+ * Writes a histogram of the sampled head positions. The positions are
+ * offsets from the leftmost accessed cell at the time of the sample.
+ *
+ * @param stream Stream to write the histogram to.
+ * @param n Amount of recorded samples.
+ */
+static void
+writeheads(FILE *stream, size_t n)
+{
+	size_t i, b, max, width;
+	unsigned long buckets[HEADBUCKETS];
+
+	for (i = max = 0; i < n; i++) {
+		if (samples[i].head > max)
+			max = samples[i].head;
+	}
+	width = max / HEADBUCKETS + 1;
+
+	memset(buckets, 0, sizeof(buckets));
+	for (i = 0; i < n; i++)
+		buckets[samples[i].head / width]++;
+
+	fprintf(stream, "# head samples\n");
+	for (b = 0; b < HEADBUCKETS && b * width <= max; b++)
+		fprintf(stream, "%zu-%zu %lu\n", b * width,
+			(b + 1) * width - 1, buckets[b]);
+}
+
+/**
+ * Writes folded stacks for flame graph tools. Each stack consists of
+ * FOLDDEPTH consecutive samples, i.e. a window of the state sequence
+ * over time, oldest state first.
+ *
+ * @param stream Stream to write the folded stacks to.
+ * @param n Amount of recorded samples.
+ */
+static void
+writefolded(FILE *stream, size_t n)
+{
+	size_t i, j, k, nstacks;
+	tmname *stacks;
+
+	if (n < FOLDDEPTH)
+		return;
+
+	nstacks = n - FOLDDEPTH + 1;
+	stacks = emalloc(nstacks * FOLDDEPTH * sizeof(tmname));
+	for (i = 0; i < nstacks; i++) {
+		for (k = 0; k < FOLDDEPTH; k++)
+			stacks[i * FOLDDEPTH + k] = samples[i + k].state;
+	}
+
+	/* Stacks are sorted lexicographically, equal ones are adjacent. */
+	qsort(stacks, nstacks, FOLDDEPTH * sizeof(tmname), cmpstack);
+
+	fprintf(stream, "# folded\n");
+	for (i = 0; i < nstacks; i = j) {
+		for (j = i + 1; j < nstacks && !cmpstack(&stacks[i * FOLDDEPTH],
+				&stacks[j * FOLDDEPTH]); j++)
+			;
+		for (k = 0; k < FOLDDEPTH; k++)
+			fprintf(stream, "%sq%d", (k) ? ";" : "",
+				stacks[i * FOLDDEPTH + k]);
+		fprintf(stream, " %zu\n", j - i);
+	}
+
+	free(stacks);
+}
+
+/**
+ * Writes a report of all recorded samples. The report consists of a
+ * histogram of the sampled states, a histogram of the sampled head
+ * positions and folded stacks of consecutive samples. Each section is
+ * introduced by a line starting with '#'.
+ *
+ * @pre Sampling must have been stopped using ::stopsampling.
+ * @param stream Stream to write the report to.
+ */
+void
+writesamples(FILE *stream)
+{
+	size_t n;
+
+	n = (size_t)nsamples;
+	fprintf(stream, "# samples %zu dropped %lu\n", n,
+		(unsigned long)ndropped);
+	if (!n)
+		return;
+
+	writehisto(stream, n);
+	writeheads(stream, n);
+	writefolded(stream, n);
+}
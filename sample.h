@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_SAMPLE_H
+#define TMSIM_SAMPLE_H
+
+#include <stdio.h>
+
+#include "turing.h"
+
+enum {
+	/**
+	 * Maximum amount of samples recorded, further samples are
+	 * dropped.
+	 */
+	MAXSAMPLES = 1 << 20,
+
+	/**
+	 * Amount of consecutive samples combined into one folded stack.
+	 */
+	FOLDDEPTH = 4,
+
+	/**
+	 * Amount of buckets of the head position histogram.
+	 */
+	HEADBUCKETS = 16,
+};
+
+void startsampling(dtm *, unsigned long);
+void stopsampling(void);
+void writesamples(FILE *);
+
+#endif
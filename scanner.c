@@ -29,6 +29,7 @@
 
 #include "queue.h"
 #include "scanner.h"
+#include "timing.h"
 #include "token.h"
 #include "turing.h"
 #include "util.h"
@@ -109,7 +110,7 @@ emit(scanner *scr, toktype tkt, int value)
 {
 	token *tok;
 
-	tok = emalloc(sizeof(token));
+	tok = tagalloc(MEM_PARSER, sizeof(token));
 	tok->type = tkt;
 	tok->line = scr->line;
 	tok->column = scr->column;
@@ -344,8 +345,10 @@ tokloop(void *pscr)
 	scanner *scr;
 
 	scr = (scanner *)pscr;
+	phasestart(PHASE_SCAN);
 	while (scr->state != NULL)
 		(*scr->state)(scr); /* fn must set scr->state. */
+	phasestop(PHASE_SCAN);
 
 	return NULL;
 }
@@ -363,7 +366,7 @@ scanstr(char *input, size_t len)
 {
 	scanner *scr;
 
-	scr = emalloc(sizeof(scanner));
+	scr = tagalloc(MEM_PARSER, sizeof(scanner));
 	scr->tqueue = newqueue();
 	scr->state = lexany;
 	scr->pos = scr->start = scr->column = 0;
@@ -0,0 +1,880 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "tape.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Magic bytes identifying a tape file.
+ */
+static const char tapemagic[8] = "TMSIMTAP";
+
+/**
+ * Header of a tape file. The header is stored at the beginning of the
+ * file, the packed cells are stored at offset TAPEHDRSIZ.
+ */
+typedef struct _tapehdr tapehdr;
+
+struct _tapehdr {
+	char magic[sizeof(tapemagic)]; /**< Always equal to tapemagic. */
+
+	uint64_t size; /**< Amount of cells stored in the file. */
+	uint64_t head; /**< Index of the cell the head is positioned on. */
+	uint64_t lo;   /**< Index of the leftmost accessed cell. */
+	uint64_t hi;   /**< Index of the rightmost accessed cell. */
+
+	uint32_t lbits; /**< Binary logarithm of the bits per cell. */
+	uint32_t nsyms; /**< Amount of symbols in the tape alphabet. */
+	char syms[UCHAR_MAX + 1]; /**< Symbol for each code. */
+};
+
+/**
+ * Sets the amount of bits used per cell and updates the derived fields
+ * of the tape accordingly. The cell buffer is not modified.
+ *
+ * @param t Tape whose cell width should be set.
+ * @param lbits Binary logarithm of the amount of bits per cell.
+ */
+static void
+setwidth(tmtape *t, unsigned int lbits)
+{
+	assert(lbits <= 3);
+
+	t->lbits = lbits;
+	t->bits = 1U << lbits;
+	t->shift = 3 - lbits;
+	t->cmask = (1U << t->bits) - 1;
+	t->imask = ((size_t)1 << t->shift) - 1;
+}
+
+/**
+ * Allocates a zeroed, and thus blank, buffer for the given amount of
+ * cells using the current cell width of the tape.
+ *
+ * @param t Tape the buffer should be allocated for.
+ * @param size Amount of cells.
+ * @returns Pointer to the allocated buffer.
+ */
+static unsigned char *
+newcells(tmtape *t, size_t size)
+{
+	unsigned char *cells;
+
+	cells = tagalloc(MEM_TAPE, size >> t->shift);
+	memset(cells, 0, size >> t->shift);
+	return cells;
+}
+
+/**
+ * Adjusts all indices of the tape after the cells have been moved
+ * to the right.
+ *
+ * @param t Tape whose cells have been moved.
+ * @param delta Amount of cells the cells have been moved by.
+ */
+static void
+shifttape(tmtape *t, size_t delta)
+{
+	t->head += delta;
+	t->lo += delta;
+	t->hi += delta;
+
+	if (t->wlo <= t->whi) {
+		t->wlo += delta;
+		t->whi += delta;
+	}
+}
+
+/**
+ * Resizes and remaps the file backing the cell buffer of the tape.
+ * Bytes added to the file are zeroed, and thus blank, by the kernel.
+ *
+ * @param t Tape whose backing file should be remapped.
+ * @param nbytes New size of the cell buffer in bytes.
+ * @returns 0 on success, -1 on failure and errno is set.
+ */
+static int
+mapcells(tmtape *t, size_t nbytes)
+{
+	void *map;
+	size_t len;
+
+	len = TAPEHDRSIZ + nbytes;
+	if (ftruncate(t->fd, (off_t)len) == -1)
+		return -1;
+
+	if (t->map && munmap(t->map, t->maplen) == -1)
+		return -1;
+	t->map = NULL;
+
+	map = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, t->fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+
+	/* Machines usually sweep over the tape. */
+	posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+
+	t->map = map;
+	t->maplen = len;
+	t->cells = t->map + TAPEHDRSIZ;
+	return 0;
+}
+
+/**
+ * Resizes the cell buffer of the tape. Bytes added to the buffer are
+ * zeroed, and thus blank.
+ *
+ * @param t Tape whose cell buffer should be resized.
+ * @param oldsiz Current size of the cell buffer in bytes.
+ * @param newsiz New size of the cell buffer in bytes.
+ */
+static void
+resizecells(tmtape *t, size_t oldsiz, size_t newsiz)
+{
+	assert(newsiz >= oldsiz);
+
+	if (t->fd != -1) {
+		if (mapcells(t, newsiz))
+			die("couldn't remap tape file");
+		return;
+	}
+
+	t->cells = tagrealloc(MEM_TAPE, t->cells, oldsiz, newsiz);
+	memset(t->cells + oldsiz, 0, newsiz - oldsiz);
+}
+
+/**
+ * Increases the amount of bits used per cell by repacking all cells
+ * of the tape. Cells are repacked in place, this avoids touching the
+ * unaccessed parts of a file-backed tape.
+ *
+ * @param t Tape whose cells should be repacked.
+ * @param lbits Binary logarithm of the new amount of bits per cell.
+ */
+static void
+widen(tmtape *t, unsigned int lbits)
+{
+	size_t i, j, first, last, stop;
+	unsigned int off;
+	unsigned char byte;
+	tmtape prev;
+
+	prev = *t;
+	setwidth(t, lbits);
+	resizecells(t, prev.size >> prev.shift, t->size >> t->shift);
+
+	/* Cells outside the accessed range are always blank. Repacking
+	 * starts at the end since the cells of an old byte are moved to
+	 * the same or a subsequent byte, the old byte is saved before it
+	 * is overwritten. */
+	first = t->lo >> prev.shift;
+	last = t->hi >> prev.shift;
+	for (i = last + 1; i-- > first;) {
+		byte = t->cells[i];
+		for (j = 0; j < ((size_t)1 << prev.shift); j++) {
+			off = (unsigned int)j << prev.lbits;
+			setcell(t, (i << prev.shift) + j,
+				(unsigned int)(byte >> off) & prev.cmask);
+		}
+	}
+
+	/* Clear old bytes which weren't overwritten by the loop above. */
+	stop = (first << prev.shift) >> t->shift;
+	if (stop > last + 1)
+		stop = last + 1;
+	if (stop > first)
+		memset(t->cells + first, 0, stop - first);
+}
+
+/**
+ * Allocates memory for a new tape and initializes it. The tape
+ * initially consists of a single blank cell and the head is positioned
+ * on the right-hand side of this cell.
+ *
+ * @returns Pointer to the newly created tape.
+ */
+tmtape *
+newtape(void)
+{
+	tmtape *t;
+
+	t = tagalloc(MEM_TAPE, sizeof(tmtape));
+	memset(t->codes, 0, sizeof(t->codes));
+	memset(t->syms, 0, sizeof(t->syms));
+
+	t->syms[0] = BLANKCHAR;
+	t->nsyms = 1;
+
+	setwidth(t, 0);
+	t->size = TAPESIZ;
+	t->cells = newcells(t, t->size);
+
+	t->lo = t->hi = t->size / 2;
+	t->head = t->hi + 1;
+
+	t->fd = -1;
+	t->map = NULL;
+	t->maplen = 0;
+
+	t->input = NULL;
+	t->inpos = 0;
+	t->inerr = 0;
+
+	t->wlo = SIZE_MAX;
+	t->whi = 0;
+
+	return t;
+}
+
+/**
+ * Allocates a new empty tape using the tape alphabet of the given tape.
+ * Each symbol is assigned the same code on both tapes.
+ *
+ * @param t Tape whose alphabet should be used.
+ * @returns Pointer to the newly created tape.
+ */
+tmtape *
+blanktape(tmtape *t)
+{
+	size_t i;
+	tmtape *r;
+
+	r = newtape();
+	for (i = 1; i < t->nsyms; i++)
+		addsym(r, t->syms[i]);
+
+	return r;
+}
+
+/**
+ * Loads a tape from a tape file previously created using ::maptape.
+ * The file is mapped read-only, the returned tape can thus only be
+ * used for inspecting the cells, e.g. using ::printcells.
+ *
+ * @param path Path of the tape file.
+ * @returns Pointer to the loaded tape or NULL on failure. If the
+ * 	file couldn't be accessed errno is set, if it isn't a valid tape
+ * 	file errno is set to zero.
+ */
+tmtape *
+loadtape(char *path)
+{
+	int fd;
+	void *map;
+	size_t i;
+	struct stat st;
+	tapehdr hdr;
+	tmtape *t;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return NULL;
+	if (fstat(fd, &st) == -1)
+		goto err;
+
+	errno = 0;
+	if (st.st_size < (off_t)TAPEHDRSIZ ||
+			read(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+		goto err;
+	if (memcmp(hdr.magic, tapemagic, sizeof(tapemagic)) ||
+			hdr.lbits > 3 || hdr.nsyms < 1 ||
+			hdr.nsyms > UCHAR_MAX + 1 || hdr.size % TAPESIZ ||
+			hdr.lo > hdr.hi || hdr.hi >= hdr.size ||
+			(uint64_t)st.st_size - TAPEHDRSIZ <
+			hdr.size >> (3 - hdr.lbits))
+		goto err;
+
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+		goto err;
+
+	t = tagalloc(MEM_TAPE, sizeof(tmtape));
+	setwidth(t, hdr.lbits);
+	t->size = (size_t)hdr.size;
+	t->head = (size_t)hdr.head;
+	t->lo = (size_t)hdr.lo;
+	t->hi = (size_t)hdr.hi;
+
+	memset(t->codes, 0, sizeof(t->codes));
+	memcpy(t->syms, hdr.syms, sizeof(t->syms));
+	t->nsyms = hdr.nsyms;
+	for (i = 1; i < t->nsyms; i++)
+		t->codes[(unsigned char)t->syms[i]] = (unsigned char)i;
+
+	t->fd = fd;
+	t->map = map;
+	t->maplen = (size_t)st.st_size;
+	t->cells = t->map + TAPEHDRSIZ;
+
+	t->input = NULL;
+	t->inpos = 0;
+	t->inerr = 0;
+
+	t->wlo = SIZE_MAX;
+	t->whi = 0;
+
+	return t;
+
+err:
+	close(fd);
+	return NULL;
+}
+
+/**
+ * Frees all resources allocated for a tape. The file backing a
+ * file-backed tape is unmapped and closed but not removed.
+ *
+ * @param t Pointer to the tape which should be freed.
+ */
+void
+freetape(tmtape *t)
+{
+	assert(t);
+
+	if (t->fd != -1) {
+		munmap(t->map, t->maplen);
+		close(t->fd);
+	} else {
+		free(t->cells);
+	}
+
+	free(t);
+}
+
+/**
+ * Moves the cells of the tape to a sparse memory-mapped file, allowing
+ * the tape to grow beyond the amount of available memory. The file is
+ * created if it doesn't exist and truncated otherwise. The accessed
+ * cells are placed in the middle of the file.
+ *
+ * @param t Tape whose cells should be moved.
+ * @param path Path of the file the cells should be stored in.
+ * @returns 0 on success, -1 on failure and errno is set.
+ */
+int
+maptape(tmtape *t, char *path)
+{
+	int saved;
+	size_t size, delta;
+	unsigned char *old;
+	tmtape prev;
+
+	assert(t->fd == -1);
+
+	prev = *t;
+	if ((t->fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644)) == -1)
+		goto err;
+
+	for (size = t->size; size < TAPECHUNK; size *= 2)
+		;
+	delta = (size - t->size) / 2;
+	delta -= delta % TAPESIZ;
+
+	if (mapcells(t, size >> t->shift))
+		goto err;
+	old = prev.cells;
+	memcpy(t->cells + (delta >> t->shift), old, t->size >> t->shift);
+	free(old);
+
+	t->size = size;
+	shifttape(t, delta);
+
+	synctape(t);
+	return 0;
+
+err:
+	saved = errno;
+	if (t->fd != -1)
+		close(t->fd);
+	*t = prev;
+	errno = saved;
+	return -1;
+}
+
+/**
+ * Writes the header of a file-backed tape, the tape file can be loaded
+ * using ::loadtape afterwards. Does nothing for other tapes.
+ *
+ * @param t Tape whose header should be written.
+ */
+void
+synctape(tmtape *t)
+{
+	tapehdr hdr;
+
+	if (t->fd == -1)
+		return;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, tapemagic, sizeof(tapemagic));
+	hdr.size = t->size;
+	hdr.head = t->head;
+	hdr.lo = t->lo;
+	hdr.hi = t->hi;
+	hdr.lbits = t->lbits;
+	hdr.nsyms = (uint32_t)t->nsyms;
+	memcpy(hdr.syms, t->syms, sizeof(hdr.syms));
+
+	memcpy(t->map, &hdr, sizeof(hdr));
+}
+
+/**
+ * Adds a symbol to the tape alphabet. If the current cell width isn't
+ * sufficient to encode all symbols of the alphabet the tape is
+ * repacked using a larger cell width.
+ *
+ * @param t Tape to whose alphabet the symbol should be added.
+ * @param sym Symbol which should be added.
+ */
+void
+addsym(tmtape *t, char sym)
+{
+	unsigned int lbits;
+	unsigned char code;
+
+	code = t->codes[(unsigned char)sym];
+	if (t->syms[code] == sym)
+		return;
+
+	assert(t->nsyms <= UCHAR_MAX);
+	code = (unsigned char)t->nsyms++;
+	t->codes[(unsigned char)sym] = code;
+	t->syms[code] = sym;
+
+	for (lbits = t->lbits; ((size_t)1 << (1U << lbits)) < t->nsyms;)
+		lbits++;
+	if (lbits != t->lbits)
+		widen(t, lbits);
+}
+
+/**
+ * Grows the cell buffer of the tape by doubling its size.
+ *
+ * @param t Tape whose buffer should be grown.
+ * @param left Whether the tape should be grown on the left-hand side.
+ */
+void
+growtape(tmtape *t, int left)
+{
+	size_t n, first, len, delta;
+
+	n = t->size >> t->shift;
+	resizecells(t, n, 2 * n);
+	delta = t->size;
+	t->size *= 2;
+	if (!left)
+		return;
+
+	/* Only the accessed cells need to be moved, all others are blank. */
+	first = t->lo >> t->shift;
+	len = (t->hi >> t->shift) - first + 1;
+	memmove(t->cells + first + n, t->cells + first, len);
+	memset(t->cells + first, 0, (len < n) ? len : n);
+
+	shifttape(t, delta);
+}
+
+/**
+ * Appends the given string to the accessed cells of the tape.
+ *
+ * @param t Tape to which the string should be appended.
+ * @param str String which should be appended.
+ */
+void
+appendtape(tmtape *t, char *str)
+{
+	size_t i, len;
+
+	len = strlen(str);
+	for (i = 0; i < len; i++)
+		addsym(t, str[i]);
+
+	while (t->hi + len >= t->size)
+		growtape(t, 0);
+
+	for (i = 0; i < len; i++)
+		setcell(t, ++t->hi, t->codes[(unsigned char)str[i]]);
+}
+
+/**
+ * Reads the next symbol from the input stream of the tape. The input
+ * is validated using the same rules as ::verifyinput, a single newline
+ * at the end of the input is ignored.
+ *
+ * @param t Tape whose input should be read.
+ * @returns The read symbol or EOF if the end of the input or an invalid
+ * 	symbol was encountered. In the latter case inerr is set.
+ */
+static int
+nextinput(tmtape *t)
+{
+	int ch, next;
+
+	if (!t->input)
+		return EOF;
+
+	if ((ch = getc(t->input)) == '\n') {
+		if ((next = getc(t->input)) == EOF)
+			ch = EOF;
+		else if (ungetc(next, t->input) == EOF)
+			die("couldn't read input");
+	}
+
+	if (ch == EOF) {
+		if (ferror(t->input))
+			die("couldn't read input");
+		t->input = NULL;
+		return EOF;
+	} else if (!isalnum(ch) || ch == BLANKCHAR) {
+		t->inerr = 1;
+		t->input = NULL;
+		return EOF;
+	}
+
+	t->inpos++;
+	return ch;
+}
+
+/**
+ * Sets the stream from which the input of the tape is read. Symbols
+ * are read lazily, i.e. once the head reaches the corresponding cell.
+ * The stream is not closed by the tape.
+ *
+ * @param t Tape whose input should be set.
+ * @param stream Stream containing the input.
+ */
+void
+inputtape(tmtape *t, FILE *stream)
+{
+	t->input = stream;
+	t->inpos = 0;
+	t->inerr = 0;
+}
+
+/**
+ * Skips the given amount of symbols of the input stream, e.g. because
+ * they were already read before a checkpoint was written.
+ *
+ * @param t Tape whose input should be skipped.
+ * @param n Amount of symbols to skip.
+ * @returns 0 on success, -1 if the input ended prematurely or
+ * 	contained an invalid symbol.
+ */
+int
+skipinput(tmtape *t, size_t n)
+{
+	while (n--) {
+		if (nextinput(t) == EOF)
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Appends the next symbol of the input stream to the accessed cells
+ * of the tape.
+ *
+ * @param t Tape whose input should be read.
+ * @returns 0 if a symbol was appended, -1 if the input was exhausted
+ * 	or contained an invalid symbol. In the latter case inerr is set.
+ */
+int
+readinput(tmtape *t)
+{
+	int ch;
+
+	if ((ch = nextinput(t)) == EOF)
+		return -1;
+
+	addsym(t, (char)ch);
+	if (t->hi + 1 >= t->size)
+		growtape(t, 0);
+
+	setcell(t, ++t->hi, t->codes[(unsigned char)ch]);
+	return 0;
+}
+
+/**
+ * Writes the accessed cells of the tape, the position of the head and
+ * the state of the input stream to the given stream. The cells are
+ * compressed using run-length encoding. Positions are stored relative
+ * to the leftmost accessed cell.
+ *
+ * @param t Tape which should be written.
+ * @param stream Stream to write the tape to.
+ * @returns 0 on success, -1 if a write error occurred.
+ */
+int
+savetape(tmtape *t, FILE *stream)
+{
+	size_t i, j;
+	unsigned int code;
+
+	putvarint(stream, t->hi - t->lo + 1);
+	putvarint(stream, t->head - t->lo);
+	if (t->wlo <= t->whi) {
+		putvarint(stream, t->wlo - t->lo + 1);
+		putvarint(stream, t->whi - t->lo + 1);
+	} else {
+		putvarint(stream, 0);
+		putvarint(stream, 0);
+	}
+
+	putc(t->input != NULL, stream);
+	putvarint(stream, t->inpos);
+
+	putvarint(stream, t->nsyms);
+	fwrite(t->syms, 1, t->nsyms, stream);
+
+	for (i = t->lo; i <= t->hi; i = j) {
+		code = getcell(t, i);
+		for (j = i + 1; j <= t->hi && getcell(t, j) == code; j++)
+			;
+		putvarint(stream, j - i);
+		putc((int)code, stream);
+	}
+
+	return ferror(stream) ? -1 : 0;
+}
+
+/**
+ * Replaces the accessed cells of the tape with those written by
+ * ::savetape and restores the position of the head. Symbols of the
+ * restored cells are added to the tape alphabet. The input stream of
+ * the tape is not modified, see ::skipinput.
+ *
+ * @param t Tape which should be restored.
+ * @param stream Stream to read the tape from.
+ * @param input Pointer to memory area where a boolean is stored
+ * 	indicating whether the input hadn't been read completely.
+ * @returns 0 on success, -1 if the tape is malformed.
+ */
+int
+restoretape(tmtape *t, FILE *stream, int *input)
+{
+	int ch;
+	size_t i;
+	uint64_t n, run, head, wlo, whi, inpos, nsyms;
+	unsigned char codes[UCHAR_MAX + 1];
+	char syms[UCHAR_MAX + 1];
+
+	if (getvarint(stream, &n) || getvarint(stream, &head) ||
+			getvarint(stream, &wlo) || getvarint(stream, &whi))
+		return -1;
+	if ((ch = getc(stream)) == EOF || getvarint(stream, &inpos))
+		return -1;
+	*input = ch;
+
+	if (getvarint(stream, &nsyms) || !nsyms || nsyms > UCHAR_MAX + 1 ||
+			fread(syms, 1, nsyms, stream) != nsyms)
+		return -1;
+	if (!n || head > n || wlo > whi || whi > n || n > SIZE_MAX / 2)
+		return -1;
+
+	for (i = 1; i < nsyms; i++)
+		addsym(t, syms[i]);
+	for (i = 0; i < nsyms; i++)
+		codes[i] = t->codes[(unsigned char)syms[i]];
+
+	/* Blank the current cells, the restored ones replace them. */
+	for (i = t->lo; i <= t->hi; i++)
+		setcell(t, i, 0);
+	t->hi = t->lo - 1;
+
+	while (t->lo + n >= t->size)
+		growtape(t, 0);
+
+	while (n > t->hi - t->lo + 1) {
+		if (getvarint(stream, &run) || (ch = getc(stream)) == EOF)
+			return -1;
+		if (!run || run > n - (t->hi - t->lo + 1) || (size_t)ch >= nsyms)
+			return -1;
+		while (run--)
+			setcell(t, ++t->hi, codes[ch]);
+	}
+
+	t->head = t->lo + head;
+	if (whi) {
+		t->wlo = t->lo + wlo - 1;
+		t->whi = t->lo + whi - 1;
+	}
+	t->inpos = inpos;
+
+	return 0;
+}
+
+/**
+ * Extends the accessed cells of the tape up to the cell the head is
+ * positioned on. Newly accessed cells are blank.
+ *
+ * @param t Tape which should be extended.
+ */
+void
+extendtape(tmtape *t)
+{
+	while (t->head >= t->size)
+		growtape(t, 0);
+
+	if (t->head > t->hi)
+		t->hi = t->head;
+}
+
+/**
+ * Writes the symbols of the cells in the given range to the given
+ * stream. The symbols are decoded into a buffer which is written
+ * using a single call to fwrite(3) once it is full.
+ *
+ * @param t Tape whose cells should be written.
+ * @param stream Stream to write the symbols to.
+ * @param lo Index of the first cell which should be written.
+ * @param hi Index of the last cell which should be written.
+ */
+static void
+writecells(tmtape *t, FILE *stream, size_t lo, size_t hi)
+{
+	size_t i, n;
+	char buf[BUFSIZ];
+
+	n = 0;
+	for (i = lo; i <= hi && i >= lo; i++) {
+		buf[n++] = t->syms[getcell(t, i)];
+		if (n == sizeof(buf)) {
+			fwrite(buf, 1, n, stream);
+			n = 0;
+		}
+	}
+
+	if (n)
+		fwrite(buf, 1, n, stream);
+}
+
+/**
+ * Writes the input which hasn't been read yet to the given stream.
+ *
+ * @param t Tape whose input should be written.
+ * @param stream Stream to write the symbols to.
+ */
+static void
+writeinput(tmtape *t, FILE *stream)
+{
+	int ch;
+
+	while ((ch = nextinput(t)) != EOF)
+		putc(ch, stream);
+}
+
+/**
+ * Writes the symbols of all accessed cells to the given stream,
+ * followed by the input which hasn't been read yet.
+ *
+ * @param t Tape whose cells should be written.
+ * @param stream Stream to write the symbols to.
+ */
+void
+printcells(tmtape *t, FILE *stream)
+{
+	writecells(t, stream, t->lo, t->hi);
+	writeinput(t, stream);
+}
+
+/**
+ * Writes the symbols of all accessed cells to the given stream,
+ * omitting leading and trailing blanks. The input which hasn't been
+ * read yet never contains blanks and is thus written as well.
+ *
+ * @param t Tape whose cells should be written.
+ * @param stream Stream to write the symbols to.
+ */
+void
+printtrimmed(tmtape *t, FILE *stream)
+{
+	size_t lo, hi;
+
+	/* Reading the next input symbol reveals whether the input is
+	 * exhausted. If it isn't, the rightmost cell holds that symbol
+	 * and no trailing blanks are trimmed. */
+	(void)readinput(t);
+
+	lo = t->lo;
+	hi = t->hi;
+
+	while (lo <= hi && !getcell(t, lo))
+		lo++;
+	while (hi > lo && !getcell(t, hi))
+		hi--;
+
+	if (lo <= hi)
+		writecells(t, stream, lo, hi);
+	writeinput(t, stream);
+}
+
+/**
+ * Writes the symbols of the accessed cells within the given distance
+ * of the head to the given stream. Input required for the window is
+ * read from the input stream.
+ *
+ * @param t Tape whose cells should be written.
+ * @param stream Stream to write the symbols to.
+ * @param n Maximum distance of a written cell from the head.
+ */
+void
+printwindow(tmtape *t, FILE *stream, size_t n)
+{
+	size_t lo, hi;
+
+	hi = (t->head > SIZE_MAX - n) ? SIZE_MAX : t->head + n;
+	while (t->hi < hi && !readinput(t))
+		;
+
+	lo = (t->head - t->lo > n) ? t->head - n : t->lo;
+	if (hi > t->hi)
+		hi = t->hi;
+
+	if (lo <= hi)
+		writecells(t, stream, lo, hi);
+}
+
+/**
+ * Writes the symbols of all cells which were written by the turing
+ * machine to the given stream. This includes cells in between written
+ * cells which weren't written themselves.
+ *
+ * @param t Tape whose cells should be written.
+ * @param stream Stream to write the symbols to.
+ */
+void
+printwritten(tmtape *t, FILE *stream)
+{
+	if (t->wlo <= t->whi)
+		writecells(t, stream, t->wlo, t->whi);
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_TAPE_H
+#define TMSIM_TAPE_H
+
+#include <limits.h>
+#include <stdio.h>
+
+#include <sys/types.h>
+
+enum {
+	/**
+	 * Amount of cells initially allocated for a tape. Must be a
+	 * multiple of the maximum amount of cells stored in one byte.
+	 */
+	TAPESIZ = 64,
+
+	/**
+	 * Minimum amount of cells allocated for a file-backed tape. The
+	 * backing file is sparse, unaccessed cells don't occupy any
+	 * space on disk. Must be a multiple of TAPESIZ.
+	 */
+	TAPECHUNK = 1 << 26,
+
+	/**
+	 * Amount of bytes reserved for the header of a tape file. The
+	 * cells are stored directly after the header.
+	 */
+	TAPEHDRSIZ = 4096,
+};
+
+/**
+ * Tape of a turing machine. Cells are stored in a contiguous buffer
+ * which grows in both directions. Each symbol of the tape alphabet is
+ * encoded as a numeric code and cells are packed using 1, 2, 4 or 8
+ * bits per cell depending on the size of the alphabet. The blank
+ * symbol is always encoded as zero, zeroed memory is thus blank.
+ *
+ * The tape is (theoretically speaking) infinite but only the cells
+ * accessed by the turing machine are considered to be part of it.
+ */
+typedef struct _tmtape tmtape;
+
+struct _tmtape {
+	unsigned char *cells; /**< Buffer containing the packed cells. */
+	size_t size;          /**< Amount of cells the buffer can hold. */
+
+	size_t head; /**< Index of the cell the head is positioned on. */
+	size_t lo;   /**< Index of the leftmost accessed cell. */
+	size_t hi;   /**< Index of the rightmost accessed cell. */
+
+	unsigned int bits;  /**< Bits used per cell, either 1, 2, 4 or 8. */
+	unsigned int lbits; /**< Binary logarithm of bits. */
+	unsigned int shift; /**< Binary logarithm of the cells per byte. */
+	unsigned int cmask; /**< Bit mask for a single cell. */
+	size_t imask;       /**< Bit mask for the cell index in a byte. */
+
+	unsigned char codes[UCHAR_MAX + 1]; /**< Code for each symbol. */
+	char syms[UCHAR_MAX + 1];           /**< Symbol for each code. */
+	size_t nsyms; /**< Amount of symbols in the tape alphabet. */
+
+	/**
+	 * File descriptor of the file backing the cell buffer or -1 if
+	 * the cell buffer is allocated on the heap.
+	 */
+	int fd;
+
+	unsigned char *map; /**< Memory mapping of the backing file. */
+	size_t maplen;      /**< Length of the memory mapping. */
+
+	/**
+	 * Stream from which the remaining input is read as soon as the
+	 * head reaches the corresponding cells or NULL if the entire
+	 * input has already been read.
+	 */
+	FILE *input;
+
+	size_t inpos; /**< Position of the next character of the input. */
+	int inerr;    /**< Whether the input contained an invalid symbol. */
+
+	size_t wlo; /**< Index of the leftmost written cell. */
+	size_t whi; /**< Index of the rightmost written cell. */
+};
+
+tmtape *newtape(void);
+tmtape *blanktape(tmtape *);
+tmtape *loadtape(char *);
+void freetape(tmtape *);
+
+int maptape(tmtape *, char *);
+void synctape(tmtape *);
+
+void addsym(tmtape *, char);
+void appendtape(tmtape *, char *);
+void inputtape(tmtape *, FILE *);
+int readinput(tmtape *);
+int skipinput(tmtape *, size_t);
+
+int savetape(tmtape *, FILE *);
+int restoretape(tmtape *, FILE *, int *);
+void extendtape(tmtape *);
+void growtape(tmtape *, int);
+void printcells(tmtape *, FILE *);
+void printtrimmed(tmtape *, FILE *);
+void printwindow(tmtape *, FILE *, size_t);
+void printwritten(tmtape *, FILE *);
+
+/**
+ * Reads the code of the cell at the given index.
+ *
+ * @param t Tape to read from.
+ * @param idx Index of the cell.
+ * @returns Code of the symbol stored in the cell.
+ */
+static inline unsigned int
+getcell(tmtape *t, size_t idx)
+{
+	unsigned int off;
+
+	off = (unsigned int)(idx & t->imask) << t->lbits;
+	return (unsigned int)(t->cells[idx >> t->shift] >> off) & t->cmask;
+}
+
+/**
+ * Stores the given code in the cell at the given index.
+ *
+ * @param t Tape to write to.
+ * @param idx Index of the cell.
+ * @param code Code which should be stored.
+ */
+static inline void
+setcell(tmtape *t, size_t idx, unsigned int code)
+{
+	unsigned int off;
+	unsigned char *byte;
+
+	off = (unsigned int)(idx & t->imask) << t->lbits;
+	byte = &t->cells[idx >> t->shift];
+	*byte = (unsigned char)((*byte & ~(t->cmask << off)) | (code << off));
+}
+
+/**
+ * Reads the symbol of the cell the head is positioned on.
+ *
+ * @pre The cell must have been accessed, see ::extendtape.
+ * @param t Tape to read from.
+ * @returns Symbol stored in the cell.
+ */
+static inline char
+readsym(tmtape *t)
+{
+	return t->syms[getcell(t, t->head)];
+}
+
+/**
+ * Writes the given symbol to the cell the head is positioned on.
+ *
+ * @pre The symbol must be part of the tape alphabet, see ::addsym.
+ * @param t Tape to write to.
+ * @param sym Symbol which should be written.
+ */
+static inline void
+writesym(tmtape *t, char sym)
+{
+	setcell(t, t->head, t->codes[(unsigned char)sym]);
+
+	if (t->head < t->wlo)
+		t->wlo = t->head;
+	if (t->head > t->whi)
+		t->whi = t->head;
+}
+
+/**
+ * Moves the head one cell to the left. The cell on the left-hand side
+ * of the new head position is considered accessed afterwards.
+ *
+ * @param t Tape whose head should be moved.
+ */
+static inline void
+headleft(tmtape *t)
+{
+	if (t->head < 2)
+		growtape(t, 1);
+
+	if (--t->head - 1 < t->lo)
+		t->lo = t->head - 1;
+}
+
+/**
+ * Moves the head one cell to the right.
+ *
+ * @param t Tape whose head should be moved.
+ */
+static inline void
+headright(tmtape *t)
+{
+	t->head++;
+}
+
+#endif
@@ -0,0 +1,26 @@
+# Input: A string consisting of 'a' and 'b' symbols.
+# Accepts palindromes using a second tape: { w | w = reverse(w) }
+
+start: q0;
+accept: q3;
+
+q0 {
+	a, $ >, > a, a => q0;
+	b, $ >, > b, b => q0;
+	$, $ <, < $, $ => q1;
+}
+
+q1 {
+	a, a <, | a, a => q1;
+	a, b <, | a, b => q1;
+	b, a <, | b, a => q1;
+	b, b <, | b, b => q1;
+	$, a >, | $, a => q2;
+	$, b >, | $, b => q2;
+}
+
+q2 {
+	a, a >, < a, a => q2;
+	b, b >, < b, b => q2;
+	$, $ |, | $, $ => q3;
+}
@@ -18,7 +18,7 @@ for test in *.csv; do
 		status="$(echo "${line}" | cut -d ',' -f2)"
 
 		echo "Testing '${test##*/}' with input '${input}':"
-		${TMSIM} "${tmsimfile}" "${input}"
+		${TMSIM} ${TMSIMFLAGS} "${tmsimfile}" "${input}"
 
 		ret=$?
 		if [ ${ret} -eq ${status} ]; then
@@ -30,4 +30,38 @@ for test in *.csv; do
 	done < "${test}"
 done
 
+# Run all inputs of a test in batch mode with each engine. A batch
+# reports the outcome of every input, a line per input.
+batch="$(mktemp)"
+trap 'rm -f "${batch}"' EXIT
+
+for test in *.csv; do
+	tmsimfile="${test%%.csv}.tm"
+	expected="$(cut -d ',' -f2 "${test}" | \
+		sed -e 's/^0$/accept/' -e 's/^[1-9][0-9]*$/reject/')"
+	cut -d ',' -f1 "${test}" > "${batch}"
+
+	printf "\n"
+
+	for engine in each lockstep interleave trie; do
+		echo "Testing '${test##*/}' in batch mode with engine '${engine}':"
+		output="$(${TMSIM} ${TMSIMFLAGS} -s -e "${engine}" \
+			-b "${batch}" "${tmsimfile}" 2>&1)"
+
+		ret=$?
+		if echo "${output}" | grep -q 'Multi-tape machines'; then
+			printf "\tSKIP: Batch mode supports a single tape only.\n"
+			break
+		elif [ ${ret} -ne 0 ]; then
+			exitstatus=1
+			printf "\tFAIL: Exited with '${ret}'.\n"
+		elif [ "$(echo "${output}" | cut -d ' ' -f1)" = "${expected}" ]; then
+			printf "\tOK.\n"
+		else
+			exitstatus=1
+			printf "\tFAIL: Outcomes differ from '${test}'.\n"
+		fi
+	done
+done
+
 exit ${exitstatus}
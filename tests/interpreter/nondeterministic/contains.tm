@@ -0,0 +1,19 @@
+# Input: A string consisting of '0' and '1' symbols.
+# Accepts inputs containing 101 by guessing where it starts.
+
+start: q0;
+accept: q3;
+
+q0 {
+	0 > 0 => q0;
+	1 > 1 => q0;
+	1 > 1 => q1;
+}
+
+q1 {
+	0 > 0 => q2;
+}
+
+q2 {
+	1 > 1 => q3;
+}
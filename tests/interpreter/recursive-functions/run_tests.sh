@@ -18,7 +18,7 @@ for test in *.csv; do
 		output="$(echo "${line}" | cut -d ',' -f2)"
 
 		echo "Testing '${test##*/}' with input '${input}':"
-		result=$(${TMSIM} -r "${tmsimfile}" "${input}" | tr -d \$)
+		result=$(${TMSIM} ${TMSIMFLAGS} -r "${tmsimfile}" "${input}" | tr -d \$)
 
 		if [ "${result}" = "${output}" ]; then
 			printf "\tOK.\n"
@@ -1,5 +1,11 @@
 #!/bin/sh
 set -e
 
-(cd decidable-sets ; ./run_tests.sh)
-(cd recursive-functions ; ./run_tests.sh)
+for flags in "" "-O"; do
+	export TMSIMFLAGS="${flags}"
+	(cd decidable-sets ; ./run_tests.sh)
+	(cd recursive-functions ; ./run_tests.sh)
+done
+
+# Nondeterministic machines can't be optimized.
+(cd nondeterministic ; ./run_tests.sh)
@@ -0,0 +1,30 @@
+# Input: A binary number.
+# Accepts if the given number has an even amount of 0s, using a state
+# 	for each parity which is entered after reading a 1.
+
+start: q1;
+accept: q5;
+
+q1 {
+	1 > 1 => q3;
+	0 > 0 => q2;
+
+	$ | $ => q5;
+}
+
+q2 {
+	1 > 1 => q4;
+	0 > 0 => q1;
+}
+
+q3 {
+	1 > 1 => q1;
+	0 > 0 => q4;
+
+	$ | $ => q5;
+}
+
+q4 {
+	1 > 1 => q2;
+	0 > 0 => q3;
+}
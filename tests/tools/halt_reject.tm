@@ -0,0 +1,13 @@
+# Input: A binary number.
+# Halts rejecting after a single step on inputs starting with a 0.
+
+start: q0;
+accept: q2;
+
+q0 {
+	0 > 0 => q1;
+}
+
+q1 {
+	1 > 1 => q1;
+}
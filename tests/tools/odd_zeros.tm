@@ -0,0 +1,17 @@
+# Input: A binary number.
+# Accepts if the given number has an odd amount of 0s.
+
+start: q1;
+accept: q0;
+
+q1 {
+	1 > 1 => q1;
+	0 > 0 => q2;
+}
+
+q2 {
+	1 > 1 => q2;
+	0 > 0 => q1;
+
+	$ | $ => q0;
+}
@@ -0,0 +1,61 @@
+#!/bin/sh
+
+BIN="${BIN:-$(pwd)/../..}"
+for prog in tmsim-bb tmsim-diff tmsim-bulk; do
+	if [ ! -x "${BIN}/${prog}" ]; then
+		echo "Couldn't find ${prog} executable: '${BIN}/${prog}'" 1>&2
+		exit 1
+	fi
+done
+
+outfile=$(mktemp ${TMPDIR:-/tmp}/tmsimXXXXXX)
+trap "rm -f '${outfile}'" INT EXIT
+
+exitstatus=0
+
+# Only the champions are compared, holdouts are written in the order
+# in which the worker threads finish them.
+for size in "2 2" "3 2"; do
+	expected="bb-$(echo "${size}" | tr ' ' '-').out"
+	printf "Testing 'tmsim-bb ${size}': "
+
+	"${BIN}/tmsim-bb" ${size} 2>/dev/null | grep ' champion ' > "${outfile}"
+	if cmp -s "${outfile}" "${expected}"; then
+		printf "OK.\n"
+	else
+		exitstatus=1
+		printf "FAIL: Champions didn't match.\n"
+		diff -u "${expected}" "${outfile}"
+	fi
+done
+
+while read -r line; do
+	left="$(echo "${line}" | cut -d ',' -f1)"
+	right="$(echo "${line}" | cut -d ',' -f2)"
+	flags="$(echo "${line}" | cut -d ',' -f3)"
+	status="$(echo "${line}" | cut -d ',' -f4)"
+
+	printf "Testing 'tmsim-diff ${flags} ${left} ${right}': "
+	"${BIN}/tmsim-diff" ${flags} "${left}" "${right}" >/dev/null 2>&1
+
+	ret=$?
+	if [ ${ret} -eq ${status} ]; then
+		printf "OK.\n"
+	else
+		exitstatus=1
+		printf "FAIL: Expected '${status}', got '${ret}'.\n"
+	fi
+done < diff.csv
+
+# Some machines halt after exactly as many steps as the limit allows.
+printf "Testing 'tmsim-bulk -s -n 38 bulk.txt': "
+"${BIN}/tmsim-bulk" -s -n 38 bulk.txt > "${outfile}"
+if cmp -s "${outfile}" bulk.out; then
+	printf "OK.\n"
+else
+	exitstatus=1
+	printf "FAIL: Output didn't match.\n"
+	diff -u bulk.out "${outfile}"
+fi
+
+exit ${exitstatus}
@@ -0,0 +1,140 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "timing.h"
+#include "util.h"
+
+/**
+ * Names of the phases as written by ::writetimings.
+ */
+static char *phasenames[NPHASES] = {
+	[PHASE_READ] = "read",
+	[PHASE_SCAN] = "scan",
+	[PHASE_PARSE] = "parse",
+	[PHASE_OPTIMIZE] = "optimize",
+	[PHASE_INPUT] = "input",
+	[PHASE_RUN] = "run",
+	[PHASE_OUTPUT] = "output",
+};
+
+/**
+ * Names of the subsystems as written by ::writetimings.
+ */
+static char *tagnames[MEM_NTAGS] = {
+	[MEM_PARSER] = "parser",
+	[MEM_MACHINE] = "machine",
+	[MEM_TAPE] = "tape",
+	[MEM_OTHER] = "other",
+};
+
+/**
+ * Whether phases are measured, see ::enabletimings.
+ */
+static int timing = 0;
+
+/**
+ * Point in time each phase was last started at.
+ */
+static struct timespec started[NPHASES];
+
+/**
+ * Total duration of each phase in nanoseconds.
+ */
+static unsigned long long elapsed[NPHASES];
+
+/**
+ * Enables measuring phase durations and accounting of allocations.
+ * Must be called before the scanner thread is started.
+ */
+void
+enabletimings(void)
+{
+	timing = 1;
+	memaccount();
+}
+
+/**
+ * Marks the start of the given phase. Does nothing unless timings were
+ * enabled using ::enabletimings.
+ *
+ * @param phase Phase which is started.
+ */
+void
+phasestart(tmphase phase)
+{
+	if (timing && clock_gettime(CLOCK_MONOTONIC, &started[phase]))
+		die("clock_gettime failed");
+}
+
+/**
+ * Marks the end of the given phase and adds the time elapsed since the
+ * corresponding call of ::phasestart to its duration.
+ *
+ * @param phase Phase which is stopped.
+ */
+void
+phasestop(tmphase phase)
+{
+	struct timespec now;
+	unsigned long long secs;
+
+	if (!timing)
+		return;
+	if (clock_gettime(CLOCK_MONOTONIC, &now))
+		die("clock_gettime failed");
+
+	/* Wraps around if tv_nsec decreased, the sum is still correct. */
+	secs = (unsigned long long)(now.tv_sec - started[phase].tv_sec);
+	elapsed[phase] += secs * 1000000000ULL +
+		(unsigned long long)now.tv_nsec -
+		(unsigned long long)started[phase].tv_nsec;
+}
+
+/**
+ * Writes the duration of each phase, the peak resident set size and
+ * the allocations of each subsystem to the given stream.
+ *
+ * @param stream Stream the report should be written to.
+ */
+void
+writetimings(FILE *stream)
+{
+	size_t i, bytes, calls;
+	struct rusage ru;
+
+	fprintf(stream, "# timings\n");
+	for (i = 0; i < NPHASES; i++)
+		fprintf(stream, "%s %.6fs\n", phasenames[i],
+			(double)elapsed[i] / 1e9);
+
+	if (!getrusage(RUSAGE_SELF, &ru))
+		fprintf(stream, "maxrss %ldKiB\n", ru.ru_maxrss);
+
+	fprintf(stream, "# allocations\n");
+	for (i = 0; i < MEM_NTAGS; i++) {
+		memusage((memtag)i, &bytes, &calls);
+		fprintf(stream, "%s %zu bytes %zu calls\n",
+			tagnames[i], bytes, calls);
+	}
+}
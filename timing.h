@@ -0,0 +1,43 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_TIMING_H
+#define TMSIM_TIMING_H
+
+#include <stdio.h>
+
+/**
+ * Phases of a simulation whose duration is measured.
+ */
+typedef enum {
+	PHASE_READ,     /**< Reading the machine file. */
+	PHASE_SCAN,     /**< Scanner thread, runs concurrently to the parser. */
+	PHASE_PARSE,    /**< Parsing the machine. */
+	PHASE_OPTIMIZE, /**< Applying optimizations and loading profiles. */
+	PHASE_INPUT,    /**< Writing the input to the tape. */
+	PHASE_RUN,      /**< Running the machine. */
+	PHASE_OUTPUT,   /**< Writing the tape. */
+	NPHASES,        /**< Amount of phases, not a valid phase. */
+} tmphase;
+
+void enabletimings(void);
+void phasestart(tmphase);
+void phasestop(tmphase);
+void writetimings(FILE *);
+
+#endif
@@ -16,14 +16,30 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/types.h>
 
 #include "turing.h"
+#include "batch.h"
+#include "enumerate.h"
+#include "ntm.h"
+#include "checkpoint.h"
+#include "debug.h"
+#include "tape.h"
+#include "optimize.h"
 #include "parser.h"
+#include "perf.h"
+#include "profile.h"
+#include "sample.h"
+#include "timing.h"
+#include "trace.h"
 #include "util.h"
 
 /**
@@ -34,7 +50,17 @@ static void
 usage(char *prog)
 {
 	fprintf(stderr, "USAGE: %s %s\n", prog,
-		"[-r] [-h|-v] FILE [INPUT]");
+		"[-r|-t|-w cells|-W] [-d] [-s] [-O] "
+		"[-p profile|-l profile] [-f tape] "
+		"[-c checkpoint [-n steps]] [-C checkpoint] [-T trace] "
+		"[-S hz [-o report]] [-P] [-M] [-D] [-h|-v] FILE "
+		"[INPUT|-i input]\n       "
+		"[-F tape]\n       "
+		"[-d] [-s] [-O] [-l profile] [-P] [-M] [-e engine] "
+		"-b inputs FILE\n       "
+		"[-d] [-O] [-l profile] [-P] [-M] [-n steps] [-j threads] "
+		"[-B] -E length FILE\n       "
+		"[-t] [-s] [-n depth] [-j threads] -N FILE [INPUT]");
 	exit(EXIT_FAILURE);
 }
 
@@ -62,6 +88,265 @@ inputerr(char *str, size_t pos)
 	exit(EXIT_FAILURE);
 }
 
+/**
+ * Writes an error message for an invalid symbol in an input read
+ * using the -i option to stderr and terminates the program with
+ * EXIT_FAILURE.
+ *
+ * @param path Path of the input file.
+ * @param pos Position of the invalid character, starting at 0.
+ */
+static void
+lazyerr(char *path, size_t pos)
+{
+	fprintf(stderr, "%s: Input error at position %zu: Input can only "
+		"consist of alphanumeric characters.\n", path, ++pos);
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * Writes the accessed cells of the given tape file to stdout and
+ * terminates the program.
+ *
+ * @param path Path of a tape file created using the -f option.
+ */
+static void
+dumptape(char *path)
+{
+	tmtape *t;
+
+	if (!(t = loadtape(path))) {
+		if (errno)
+			die("couldn't load tape file");
+		fprintf(stderr, "%s: Malformed tape file.\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	printcells(t, stdout);
+	putchar('\n');
+	freetape(t);
+
+	if (fflush(stdout))
+		die("couldn't write tape");
+	exit(EXIT_SUCCESS);
+}
+
+/**
+ * Writes the part of the tape selected by the given option to stdout.
+ * Each tape of a multi-tape machine is written on a separate line.
+ *
+ * @param tm Turing machine whose tapes should be written.
+ * @param view Option used to select the part of the tape.
+ * @param window Amount of cells on each side of the head for -w.
+ */
+static void
+writeview(dtm *tm, int view, size_t window)
+{
+	size_t i;
+	tmtape *t;
+
+	for (i = 0; i < tm->ntapes; i++) {
+		t = (i) ? tm->xtape[i - 1] : tm->tape;
+		switch (view) {
+		case 'r':
+			printcells(t, stdout);
+			break;
+		case 't':
+			printtrimmed(t, stdout);
+			break;
+		case 'w':
+			printwindow(t, stdout, window);
+			break;
+		case 'W':
+			printwritten(t, stdout);
+			break;
+		}
+
+		putchar('\n');
+	}
+}
+
+/**
+ * Parses the name of a batch engine passed to the -e option.
+ *
+ * @param name Name of the engine.
+ * @returns Engine or ENGINE_AUTO if the name is unknown.
+ */
+static tmengine
+enginearg(char *name)
+{
+	if (!strcmp(name, "each"))
+		return ENGINE_EACH;
+	else if (!strcmp(name, "lockstep"))
+		return ENGINE_LOCKSTEP;
+	else if (!strcmp(name, "interleave"))
+		return ENGINE_INTERLEAVE;
+	else if (!strcmp(name, "trie"))
+		return ENGINE_TRIE;
+
+	return ENGINE_AUTO;
+}
+
+/**
+ * Runs the given turing machine on each line of the given file and
+ * writes one result line per input to stdout.
+ *
+ * @param tm Turing machine which should be run.
+ * @param path Path of the file containing the inputs.
+ * @param engine Engine which should be used.
+ * @param steps Whether the amount of steps should be written as well.
+ * @param ctrs Performance counters or NULL.
+ */
+static void
+runbatch(dtm *tm, char *path, tmengine engine, int steps, perfctrs *ctrs)
+{
+	size_t bad;
+	tmbatch *b;
+	tmdense *d;
+
+	phasestart(PHASE_INPUT);
+	if (!(b = readbatch(path, &bad))) {
+		if (errno)
+			die("couldn't read inputs");
+		fprintf(stderr, "%s:%zu: Input can only consist of "
+			"alphanumeric characters.\n", path, ++bad);
+		exit(EXIT_FAILURE);
+	}
+	phasestop(PHASE_INPUT);
+
+	if (ctrs)
+		perfstart(ctrs);
+	phasestart(PHASE_RUN);
+	d = (engine != ENGINE_EACH) ? newdense(tm) : NULL;
+	if (!d || engine == ENGINE_AUTO)
+		engine = batchengine(d);
+
+	switch (engine) {
+	case ENGINE_LOCKSTEP:
+		lockstep(d, b);
+		break;
+	case ENGINE_INTERLEAVE:
+		interleave(d, b);
+		break;
+	case ENGINE_TRIE:
+		runtrie(d, b);
+		break;
+	default:
+		runeach(tm, b);
+		break;
+	}
+
+	if (d)
+		freedense(d);
+	phasestop(PHASE_RUN);
+	if (ctrs) {
+		perfstop(ctrs);
+		perfreport(ctrs, "run", 0, stderr);
+		perfclose(ctrs);
+	}
+
+	phasestart(PHASE_OUTPUT);
+	writebatch(b, stdout, steps);
+	if (fflush(stdout))
+		die("couldn't write results");
+	phasestop(PHASE_OUTPUT);
+
+	freebatch(b);
+}
+
+/**
+ * Runs the given turing machine on all inputs up to the given length
+ * and writes the accepted inputs to stdout and a summary to stderr.
+ *
+ * @param tm Turing machine which should be run.
+ * @param a Input alphabet of the machine before it was optimized.
+ * @param maxlen Maximum length of an input.
+ * @param budget Maximum amount of steps performed for a single input.
+ * @param nthreads Amount of threads.
+ * @param bitmap Whether a run-length encoded bitmap should be written
+ * 	instead of the accepted inputs.
+ * @param ctrs Performance counters or NULL. They must be opened before
+ * 	the worker threads are created, which inherit them.
+ */
+static void
+runenumerate(dtm *tm, tmalpha *a, size_t maxlen, unsigned long budget,
+		unsigned int nthreads, int bitmap, perfctrs *ctrs)
+{
+	tmdense *d;
+	tmenum *e;
+
+	if (!(d = newdense(tm))) {
+		fprintf(stderr, "Machine is too large to be enumerated.\n");
+		exit(EXIT_FAILURE);
+	} else if (!(e = newenum(a, d, maxlen, budget))) {
+		fprintf(stderr, "Too many inputs up to length %zu.\n", maxlen);
+		exit(EXIT_FAILURE);
+	}
+
+	if (ctrs)
+		perfstart(ctrs);
+	phasestart(PHASE_RUN);
+	runenum(e, nthreads);
+	phasestop(PHASE_RUN);
+	if (ctrs) {
+		perfstop(ctrs);
+		perfreport(ctrs, "run", 0, stderr);
+		perfclose(ctrs);
+	}
+
+	phasestart(PHASE_OUTPUT);
+	if (bitmap)
+		writebitmap(e, stdout);
+	else
+		writeaccepted(e, stdout);
+	if (fflush(stdout))
+		die("couldn't write results");
+	phasestop(PHASE_OUTPUT);
+
+	fprintf(stderr, "accepted %"PRIu64"\nrejected %"PRIu64"\n"
+		"timeout %"PRIu64"\n", e->counts[ENUM_ACCEPT],
+		e->counts[ENUM_REJECT], e->counts[ENUM_TIMEOUT]);
+
+	freeenum(e);
+	freedense(d);
+}
+
+/**
+ * Explores all branches of a nondeterministic turing machine
+ * breadth-first.
+ *
+ * @param tm Nondeterministic turing machine which should be run.
+ * @param input Input for the machine.
+ * @param limit Maximum depth of the configuration tree.
+ * @param nthreads Amount of threads.
+ * @param rtape Whether the trimmed tape of the accepting branch should
+ * 	be written to stdout.
+ * @param steps Whether the depth of the accepting branch should be
+ * 	written to stderr.
+ * @returns EXIT_SUCCESS if any branch accepts, EXIT_FAILURE otherwise.
+ */
+static int
+runnondet(dtm *tm, char *input, unsigned long limit,
+		unsigned int nthreads, int rtape, int steps)
+{
+	unsigned long depth;
+	ntmres res;
+
+	phasestart(PHASE_RUN);
+	res = runntm(tm, input, limit, nthreads, &depth,
+		(rtape) ? stdout : NULL);
+	phasestop(PHASE_RUN);
+
+	if (res == NTM_LIMIT)
+		fprintf(stderr, "Depth limit of %lu reached.\n", limit);
+	if (steps)
+		fprintf(stderr, "%lu\n", depth);
+	if (fflush(stdout))
+		die("couldn't write tape");
+
+	return (res == NTM_ACCEPT) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 /**
  * The main function invoked when the program is started.
  *
@@ -71,19 +356,131 @@ inputerr(char *str, size_t pos)
 int
 main(int argc, char **argv)
 {
-	size_t pos;
-	int opt, ext, rtape;
+	size_t pos, window, maxlen;
+	int opt, ext, rtape, prune, optimize, steps, debug, perf, timings;
+	int enumerate, bitmap, nondet;
+	unsigned long every, hz, base, budget, nthreads;
+	long nprocs;
+	tmname state;
+	tmengine engine;
 	parerr ret;
+	ckpterr cret;
+	perfctrs ctrs;
+	tmalpha alpha;
 	dtm *tm;
 	parser *par;
-	char *in, *fc, *fp;
+	char *in, *fc, *fp, *pout, *pin, *tfile, *ifile, *cout, *cin, *tout, *sout, *bin, *end;
+	FILE *pfd, *ifd, *cfd, *tfd, *sfd;
 	ssize_t len;
 
-	rtape = 0;
-	while ((opt = getopt(argc, argv, "rhv")) != -1) {
+	pout = pin = tfile = ifile = cout = cin = tout = sout = bin = NULL;
+	hz = budget = nthreads = 0;
+	ifd = NULL;
+	window = maxlen = 0;
+	enumerate = bitmap = nondet = 0;
+	every = CKPTSTEPS;
+	rtape = prune = optimize = steps = debug = perf = timings = 0;
+	engine = ENGINE_AUTO;
+	while ((opt = getopt(argc, argv, "rtw:WdsOp:l:f:F:i:c:n:C:T:S:o:PMDb:e:E:j:BNhv")) != -1) {
 		switch (opt) {
+		case 'w':
+			errno = 0;
+			window = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-')
+				usage(argv[0]);
+			/* FALLTHROUGH */
 		case 'r':
-			rtape = 1;
+		case 't':
+		case 'W':
+			if (rtape && rtape != opt)
+				usage(argv[0]);
+			rtape = opt;
+			break;
+		case 'd':
+			prune = 1;
+			break;
+		case 's':
+			steps = 1;
+			break;
+		case 'O':
+			optimize = 1;
+			break;
+		case 'p':
+			pout = optarg;
+			break;
+		case 'l':
+			pin = optarg;
+			break;
+		case 'f':
+			tfile = optarg;
+			break;
+		case 'F':
+			dumptape(optarg);
+			break;
+		case 'i':
+			ifile = optarg;
+			break;
+		case 'c':
+			cout = optarg;
+			break;
+		case 'n':
+			errno = 0;
+			every = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-' || !every)
+				usage(argv[0]);
+			budget = every;
+			break;
+		case 'C':
+			cin = optarg;
+			break;
+		case 'T':
+			tout = optarg;
+			break;
+		case 'S':
+			errno = 0;
+			hz = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-' ||
+					!hz || hz > 1000000)
+				usage(argv[0]);
+			break;
+		case 'o':
+			sout = optarg;
+			break;
+		case 'P':
+			perf = 1;
+			break;
+		case 'M':
+			timings = 1;
+			break;
+		case 'D':
+			debug = 1;
+			break;
+		case 'b':
+			bin = optarg;
+			break;
+		case 'e':
+			if ((engine = enginearg(optarg)) == ENGINE_AUTO)
+				usage(argv[0]);
+			break;
+		case 'E':
+			errno = 0;
+			maxlen = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-')
+				usage(argv[0]);
+			enumerate = 1;
+			break;
+		case 'j':
+			errno = 0;
+			nthreads = strtoul(optarg, &end, 10);
+			if (errno || *end || !*optarg || *optarg == '-' ||
+					!nthreads || nthreads > UINT_MAX)
+				usage(argv[0]);
+			break;
+		case 'B':
+			bitmap = 1;
+			break;
+		case 'N':
+			nondet = 1;
 			break;
 		case 'v':
 			fprintf(stderr, "tmsim-"VERSION"\n");
@@ -94,13 +491,50 @@ main(int argc, char **argv)
 		}
 	}
 
-	if (argc <= 1 || optind >= argc)
+	/* State names of the profile must match the input file. The
+	 * debugger reads commands from stdin and can't revert reading
+	 * input lazily. A trace only stores the initial tape which
+	 * doesn't contain the lazily read input. The amount of steps
+	 * given by -n is only used by checkpointing, the enumeration and
+	 * the nondeterministic mode. */
+	if (argc <= 1 || optind >= argc || (pout && pin) ||
+			(debug && (ifile || cin || cout || tout || pout)) ||
+			(tout && ifile) ||
+			(bin && (rtape || debug || ifile || cin || cout ||
+			tout || pout || tfile || hz || optind + 1 < argc)) ||
+			(enumerate && (bin || rtape || debug || ifile ||
+			cin || cout || tout || pout || tfile || hz || steps ||
+			optind + 1 < argc)) ||
+			(nondet && ((rtape && rtape != 't') || prune ||
+			optimize || pout || pin || tfile || ifile || cout ||
+			cin || tout || hz || perf || debug || bin ||
+			enumerate)) ||
+			(budget && !cout && !enumerate && !nondet) ||
+			(!bin && engine != ENGINE_AUTO) ||
+			(!enumerate && !nondet && (nthreads || bitmap)) ||
+			(nondet && bitmap))
 		usage(argv[0]);
 
+	if (timings)
+		enabletimings();
+
 	fp = argv[optind];
+	phasestart(PHASE_READ);
 	if ((len = readfile(&fc, fp)) == -1)
 		die("couldn't read from input file");
+	phasestop(PHASE_READ);
+
+	/* The scanner runs in a thread of its own which is started by
+	 * newparser and must inherit the counters. */
+	phasestart(PHASE_PARSE);
+	if (perf) {
+		perfopen(&ctrs);
+		perfstart(&ctrs);
+	}
+
 	par = newparser(fc, (size_t)len);
+	par->nondet = nondet;
+	par->maxtapes = (nondet) ? 1 : TMMAXTAPES;
 
 	tm = newtm();
 	if ((ret = parsetm(par, tm)) != PAR_OK) {
@@ -108,18 +542,201 @@ main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 	freeparser(par);
+	phasestop(PHASE_PARSE);
 
-	if (argc <= 2 || ++optind >= argc)
+	/* Only the interpreter supports multiple tapes. */
+	if (tm->ntapes > 1 && (pout || pin || tfile || cout || cin ||
+			tout || debug || bin || enumerate)) {
+		fprintf(stderr, "%s: Multi-tape machines can't be used with "
+			"-p, -l, -f, -c, -C, -T, -D, -b or -E.\n", fp);
+		return EXIT_FAILURE;
+	}
+
+	if (perf) {
+		perfstop(&ctrs);
+		perfreport(&ctrs, "parse", 0, stderr);
+	}
+
+	/* Optimizations assume a single transition per symbol. */
+	if (nondet) {
+		if (argc <= 2 || ++optind >= argc)
+			return EXIT_SUCCESS;
+		in = argv[optind];
+		if (!verifyinput(in, &pos))
+			inputerr(in, pos);
+		if (!nthreads)
+			nthreads = ((nprocs = sysconf(_SC_NPROCESSORS_ONLN)) > 0) ?
+				(unsigned long)nprocs : 1;
+		ext = runnondet(tm, in, (budget) ? budget : NTMSTEPS,
+			(unsigned int)nthreads, rtape, steps);
+		if (timings)
+			writetimings(stderr);
+		return ext;
+	}
+
+	/* Optimizations remove transitions and thereby the symbols of
+	 * the input alphabet. */
+	if (enumerate)
+		inputalpha(&alpha, &tm, 1);
+
+	phasestart(PHASE_OPTIMIZE);
+	if (pin) {
+		if (!(pfd = fopen(pin, "r")))
+			die("couldn't open profile");
+		if (readprofile(tm, pfd)) {
+			fprintf(stderr, "%s: Malformed profile.\n", pin);
+			return EXIT_FAILURE;
+		}
+		fclose(pfd);
+		layout(tm);
+	}
+
+	/* Removing transitions into undefined states skips a step, the
+	 * amount of steps is reported, limited or checkpointed by these
+	 * modes and recorded in profiles and traces. */
+	if (optimize)
+		minimize(tm, rtape, steps || bin || enumerate || cout || cin ||
+			pout || tout);
+
+	/* Rejecting early alters the resulting tape and truncates the
+	 * run, only do so by default if nothing but the result of the
+	 * run is reported. */
+	if (prune || (!rtape && !steps && !pout && !tout && !hz && !perf))
+		markdead(tm);
+
+	/* Fused transitions would distort the profile, trace and the
+	 * step numbers of the debugger. Batch engines and the
+	 * enumeration use the plain transition table. */
+	if (optimize && !pout && !tout && !debug && !bin && !enumerate)
+		fuse(tm);
+	phasestop(PHASE_OPTIMIZE);
+
+	if (bin) {
+		runbatch(tm, bin, engine, steps, (perf) ? &ctrs : NULL);
+		if (timings)
+			writetimings(stderr);
 		return EXIT_SUCCESS;
+	}
 
-	in = argv[optind];
-	if (!verifyinput(in, &pos))
-		inputerr(in, pos);
-	writetape(tm, in);
+	if (enumerate) {
+		if (!nthreads)
+			nthreads = ((nprocs = sysconf(_SC_NPROCESSORS_ONLN)) > 0) ?
+				(unsigned long)nprocs : 1;
+		runenumerate(tm, &alpha, maxlen, (budget) ? budget : ENUMSTEPS,
+			(unsigned int)nthreads, bitmap, (perf) ? &ctrs : NULL);
+		if (timings)
+			writetimings(stderr);
+		return EXIT_SUCCESS;
+	}
+
+	if (tfile && maptape(tm->tape, tfile))
+		die("couldn't map tape file");
 
-	ext = (runtm(tm)) ? EXIT_FAILURE : EXIT_SUCCESS;
-	if (rtape)
-		printtape(tm);
+	if (ifile) {
+		if (optind + 1 < argc)
+			usage(argv[0]);
+		if (!strcmp(ifile, "-"))
+			ifd = stdin;
+		else if (!(ifd = fopen(ifile, "r")))
+			die("couldn't open input");
+	}
+
+	phasestart(PHASE_INPUT);
+	if (cin) {
+		if (optind + 1 < argc)
+			usage(argv[0]);
+		if (!(cfd = fopen(cin, "r")))
+			die("couldn't open checkpoint");
+		if ((cret = readckpt(tm, cfd, ifd, &state)) != CKPT_OK) {
+			strckpterr(cret, cin, stderr);
+			return EXIT_FAILURE;
+		}
+		fclose(cfd);
+	} else if (ifd) {
+		inputtape(tm->tape, ifd);
+	} else {
+		if (argc <= 2 || ++optind >= argc)
+			return EXIT_SUCCESS;
+
+		in = argv[optind];
+		if (!verifyinput(in, &pos))
+			inputerr(in, pos);
+		writetape(tm, in);
+	}
+	phasestop(PHASE_INPUT);
+
+	if (debug) {
+		debugtm(tm, stdin, stdout);
+		return EXIT_SUCCESS;
+	}
+
+	if (cout)
+		autockpt(tm, cout, every);
+	if (tout) {
+		if (!(tfd = fopen(tout, "w")))
+			die("couldn't open trace");
+		tm->trace = newtrace(tm, (cin) ? state : tm->start, tfd);
+	}
+
+	tm->profile = pout != NULL;
+	base = tm->steps;
+	if (perf)
+		perfstart(&ctrs);
+	if (hz)
+		startsampling(tm, hz);
+	phasestart(PHASE_RUN);
+	if (cin)
+		ext = (resumetm(tm, state)) ? EXIT_FAILURE : EXIT_SUCCESS;
+	else
+		ext = (runtm(tm)) ? EXIT_FAILURE : EXIT_SUCCESS;
+	phasestop(PHASE_RUN);
+	if (hz)
+		stopsampling();
+	if (perf) {
+		perfstop(&ctrs);
+		perfreport(&ctrs, "run", tm->steps - base, stderr);
+		perfclose(&ctrs);
+	}
+	waitckpt(tm);
+	synctape(tm->tape);
+
+	if (tout && (closetrace(tm->trace) || fclose(tfd)))
+		die("couldn't write trace");
+	if (tm->tape->inerr)
+		lazyerr(ifile, tm->tape->inpos);
+
+	if (rtape) {
+		phasestart(PHASE_OUTPUT);
+		writeview(tm, rtape, window);
+		phasestop(PHASE_OUTPUT);
+		if (tm->tape->inerr)
+			lazyerr(ifile, tm->tape->inpos);
+	}
+	if (steps)
+		fprintf(stderr, "%lu\n", tm->steps);
+
+	if (hz) {
+		if (!sout)
+			sfd = stderr;
+		else if (!(sfd = fopen(sout, "w")))
+			die("couldn't open sample report");
+		writesamples(sfd);
+		if (sfd != stderr && fclose(sfd))
+			die("couldn't write sample report");
+	}
+
+	if (timings) {
+		fflush(stdout);
+		writetimings(stderr);
+	}
+
+	if (pout) {
+		if (!(pfd = fopen(pout, "w")))
+			die("couldn't open profile");
+		writeprofile(tm, pfd);
+		if (fclose(pfd))
+			die("couldn't write profile");
+	}
 
 	return ext;
 }
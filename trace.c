@@ -0,0 +1,329 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+
+#include "tape.h"
+#include "trace.h"
+#include "turing.h"
+#include "util.h"
+
+/**
+ * Magic bytes identifying a trace file.
+ */
+static const char tracemagic[8] = "TMSIMTRC";
+
+/**
+ * Decodes a difference encoded using ::zigzag.
+ *
+ * @param val Encoded difference.
+ * @returns Decoded difference.
+ */
+static int64_t
+unzigzag(uint64_t val)
+{
+	return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+/**
+ * Assigns the next identifier to a transition and writes the
+ * transition to the header of the trace file.
+ *
+ * @param trans Transition which should be numbered.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to the trace.
+ */
+static void
+numbertrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	tmtrace *t;
+
+	t = arg;
+	trans->id = t->prev++;
+
+	putvarint(t->stream, zigzag(state->name));
+	putc(trans->rsym, t->stream);
+	putc(trans->wsym, t->stream);
+	putc(trans->headdir, t->stream);
+	putvarint(t->stream, zigzag(trans->nextstate));
+	putvarint(t->stream, trans->steps);
+}
+
+/**
+ * Numbers all transitions of a state, see ::numbertrans.
+ *
+ * @param state State whose transitions should be numbered.
+ * @param arg Void pointer to the trace.
+ */
+static void
+numberstate(tmstate *state, void *arg)
+{
+	eachtrans(state, numbertrans, arg);
+}
+
+/**
+ * Increments the counter pointed to by the given void pointer.
+ *
+ * @param trans Transition which should be counted.
+ * @param state State the transition belongs to.
+ * @param arg Void pointer to the counter.
+ */
+static void
+counttrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	(void)trans;
+	(void)state;
+
+	(*(size_t *)arg)++;
+}
+
+/**
+ * Counts the transitions of a state, see ::counttrans.
+ *
+ * @param state State whose transitions should be counted.
+ * @param arg Void pointer to the counter.
+ */
+static void
+countstate(tmstate *state, void *arg)
+{
+	eachtrans(state, counttrans, arg);
+}
+
+/**
+ * Starts recording an execution trace of the given turing machine. The
+ * header of the trace file contains all transitions of the machine,
+ * its current tape, state and step count. The trace can thus be
+ * replayed without the machine definition.
+ *
+ * @param tm Turing machine which should be traced.
+ * @param state Name of the state the machine is started in.
+ * @param stream Stream the trace should be written to.
+ * @returns Pointer to the newly created trace.
+ */
+tmtrace *
+newtrace(dtm *tm, tmname state, FILE *stream)
+{
+	size_t n;
+	tmtrace *t;
+
+	t = emalloc(sizeof(tmtrace));
+	t->stream = stream;
+	t->buf = emalloc(TRACEBUFSIZ);
+	t->len = 0;
+	t->prev = 0;
+
+	n = 0;
+	eachstate(tm, countstate, &n);
+
+	fwrite(tracemagic, 1, sizeof(tracemagic), stream);
+	putvarint(stream, tm->steps);
+	putvarint(stream, zigzag(state));
+	putvarint(stream, n);
+	eachstate(tm, numberstate, t);
+	if (savetape(tm->tape, stream))
+		die("couldn't write trace");
+
+	t->prev = 0;
+	return t;
+}
+
+/**
+ * Writes all buffered records of the trace to the trace file.
+ *
+ * @param t Trace whose records should be written.
+ */
+void
+flushtrace(tmtrace *t)
+{
+	if (fwrite(t->buf, 1, t->len, t->stream) != t->len)
+		die("couldn't write trace");
+	t->len = 0;
+}
+
+/**
+ * Writes all buffered records of the trace to the trace file and frees
+ * all resources allocated for the trace. The stream is not closed.
+ *
+ * @param t Trace which should be closed.
+ * @returns 0 on success, -1 if a write error occurred.
+ */
+int
+closetrace(tmtrace *t)
+{
+	int ret;
+
+	flushtrace(t);
+	ret = (fflush(t->stream) || ferror(t->stream)) ? -1 : 0;
+
+	free(t->buf);
+	free(t);
+	return ret;
+}
+
+/**
+ * Opens a trace written by ::newtrace for replaying. The tape and
+ * state of the replay are initialized to those of the turing machine
+ * when the trace was started.
+ *
+ * @param stream Stream to read the trace from.
+ * @returns Pointer to the replay or NULL if the trace is malformed.
+ */
+tmreplay *
+openreplay(FILE *stream)
+{
+	int rsym, wsym, dir, pending;
+	size_t i;
+	uint64_t steps, state, n, next, nsteps;
+	char magic[sizeof(tracemagic)];
+	tmreplay *r;
+
+	if (fread(magic, 1, sizeof(magic), stream) != sizeof(magic) ||
+			memcmp(magic, tracemagic, sizeof(magic)))
+		return NULL;
+	if (getvarint(stream, &steps) || getvarint(stream, &state) ||
+			getvarint(stream, &n) || steps > ULONG_MAX ||
+			n > SIZE_MAX / sizeof(tmtrans))
+		return NULL;
+
+	r = emalloc(sizeof(tmreplay));
+	r->stream = stream;
+	r->trans = emalloc((n ? n : 1) * sizeof(tmtrans));
+	r->from = emalloc((n ? n : 1) * sizeof(tmname));
+	r->ntrans = (size_t)n;
+	r->tape = newtape();
+	r->state = (tmname)unzigzag(state);
+	r->step = (unsigned long)steps;
+	r->prev = 0;
+	r->err = 0;
+
+	for (i = 0; i < r->ntrans; i++) {
+		if (getvarint(stream, &state) || (rsym = getc(stream)) == EOF ||
+				(wsym = getc(stream)) == EOF ||
+				(dir = getc(stream)) == EOF || dir > STAY ||
+				getvarint(stream, &next) ||
+				getvarint(stream, &nsteps))
+			goto err;
+
+		r->from[i] = (tmname)unzigzag(state);
+		r->trans[i].rsym = (char)rsym;
+		r->trans[i].wsym = (char)wsym;
+		r->trans[i].headdir = (direction)dir;
+		r->trans[i].nextstate = (tmname)unzigzag(next);
+		r->trans[i].count = 0;
+		r->trans[i].steps = (unsigned long)nsteps;
+		r->trans[i].id = i;
+		r->trans[i].alt = NULL;
+
+		addsym(r->tape, (char)rsym);
+		addsym(r->tape, (char)wsym);
+	}
+
+	if (restoretape(r->tape, stream, &pending))
+		goto err;
+
+	return r;
+
+err:
+	freereplay(r);
+	return NULL;
+}
+
+/**
+ * Reads the next record of a trace and performs the recorded
+ * transition on the tape of the replay.
+ *
+ * @param r Replay to advance.
+ * @param dest Pointer to memory area where a pointer to the performed
+ * 	transition is stored.
+ * @param from Pointer to memory area where the name of the state the
+ * 	performed transition belongs to is stored.
+ * @returns 0 on success, -1 at the end of the trace or if the record is
+ * 	malformed. In the latter case err is set.
+ */
+int
+replaystep(tmreplay *r, tmtrans **dest, tmname *from)
+{
+	int ch;
+	int64_t id;
+	uint64_t val;
+	tmtrans *trans;
+
+	if ((ch = getc(r->stream)) == EOF)
+		return -1;
+	if (ungetc(ch, r->stream) == EOF || getvarint(r->stream, &val))
+		goto err;
+
+	id = (int64_t)r->prev + unzigzag(val);
+	if (id < 0 || (uint64_t)id >= r->ntrans || r->from[id] != r->state)
+		goto err;
+	trans = &r->trans[id];
+	r->prev = (unsigned long)id;
+
+	/* Newly accessed cells are blank or were read lazily from the
+	 * input, the transition overwrites them either way. */
+	if (r->tape->head > r->tape->hi)
+		extendtape(r->tape);
+
+	writesym(r->tape, trans->wsym);
+	switch (trans->headdir) {
+	case RIGHT:
+		headright(r->tape);
+		break;
+	case LEFT:
+		headleft(r->tape);
+		break;
+	case STAY:
+		/* Nothing to do here. */
+		break;
+	}
+
+	/* The interpreter accesses the cell under the head before looking
+	 * for the next transition, even if it halts afterwards. */
+	if (r->tape->head > r->tape->hi)
+		extendtape(r->tape);
+
+	r->step += trans->steps;
+	r->state = trans->nextstate;
+
+	*dest = trans;
+	*from = r->from[id];
+	return 0;
+
+err:
+	r->err = 1;
+	return -1;
+}
+
+/**
+ * Frees all resources allocated for a replay. The stream is not closed.
+ *
+ * @param r Replay which should be freed.
+ */
+void
+freereplay(tmreplay *r)
+{
+	freetape(r->tape);
+	free(r->trans);
+	free(r->from);
+	free(r);
+}
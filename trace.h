@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2016-2019 Sören Tempel
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Affero General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public
+ * License along with this program. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TMSIM_TRACE_H
+#define TMSIM_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tape.h"
+#include "turing.h"
+
+enum {
+	/**
+	 * Size of the buffer used for trace records. The buffer is
+	 * written to the trace file once it is full.
+	 */
+	TRACEBUFSIZ = 1 << 16,
+
+	/**
+	 * Maximum size of a single encoded trace record.
+	 */
+	TRACERECSIZ = 10,
+};
+
+/**
+ * Execution trace which is currently being recorded. Each executed
+ * transition is recorded as the difference between its identifier and
+ * the identifier of the previously executed one, see ::tracetrans.
+ */
+typedef struct _tmtrace tmtrace;
+
+struct _tmtrace {
+	FILE *stream;       /**< Stream the trace is written to. */
+	unsigned char *buf; /**< Buffer for records not written yet. */
+	size_t len;         /**< Amount of bytes used in the buffer. */
+	unsigned long prev; /**< Identifier of the previous transition. */
+};
+
+/**
+ * Execution trace which is currently being replayed. The tape and
+ * current state are updated as records are read, see ::replaystep.
+ */
+typedef struct _tmreplay tmreplay;
+
+struct _tmreplay {
+	FILE *stream; /**< Stream the trace is read from. */
+
+	tmtrans *trans; /**< Transitions indexed by identifier. */
+	tmname *from;   /**< State each transition belongs to. */
+	size_t ntrans;  /**< Amount of transitions. */
+
+	tmtape *tape;       /**< Tape of the traced turing machine. */
+	tmname state;       /**< Current state of the turing machine. */
+	unsigned long step; /**< Amount of steps performed so far. */
+	unsigned long prev; /**< Identifier of the previous transition. */
+	int err;            /**< Whether a malformed record was read. */
+};
+
+tmtrace *newtrace(dtm *, tmname, FILE *);
+void flushtrace(tmtrace *);
+int closetrace(tmtrace *);
+
+tmreplay *openreplay(FILE *);
+int replaystep(tmreplay *, tmtrans **, tmname *);
+void freereplay(tmreplay *);
+
+/**
+ * Encodes a signed difference such that values with a small absolute
+ * value are mapped to small unsigned values.
+ *
+ * @param delta Difference which should be encoded.
+ * @returns Encoded difference.
+ */
+static inline uint64_t
+zigzag(int64_t delta)
+{
+	return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+/**
+ * Records the execution of the given transition. Records are appended
+ * to a buffer which is written to the trace file in large blocks.
+ *
+ * @param t Trace which is currently being recorded.
+ * @param trans Transition which was executed.
+ */
+static inline void
+tracetrans(tmtrace *t, tmtrans *trans)
+{
+	uint64_t val;
+
+	if (t->len > TRACEBUFSIZ - TRACERECSIZ)
+		flushtrace(t);
+
+	val = zigzag((int64_t)trans->id - (int64_t)t->prev);
+	t->prev = trans->id;
+
+	while (val >= 0x80) {
+		t->buf[t->len++] = (unsigned char)((val & 0x7f) | 0x80);
+		val >>= 7;
+	}
+	t->buf[t->len++] = (unsigned char)val;
+}
+
+#endif
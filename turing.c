@@ -18,12 +18,15 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <sys/types.h>
 
+#include "tape.h"
+#include "trace.h"
 #include "turing.h"
 #include "util.h"
 
@@ -51,9 +54,9 @@ newtmmap(size_t size)
 	size_t i;
 	tmmap *map;
 
-	map = emalloc(sizeof(tmmap));
+	map = tagalloc(MEM_MACHINE, sizeof(tmmap));
 	map->size = size;
-	map->entries = emalloc(sizeof(mapentry *) * size);
+	map->entries = tagalloc(MEM_MACHINE, sizeof(mapentry *) * size);
 
 	for (i = 0; i < size; i++)
 		map->entries[i] = NULL;
@@ -87,7 +90,7 @@ newmapentry(mapkey key)
 {
 	mapentry *ent;
 
-	ent = emalloc(sizeof(mapentry));
+	ent = tagalloc(MEM_MACHINE, sizeof(mapentry));
 	ent->key = key;
 	ent->next = NULL;
 	return ent;
@@ -112,6 +115,25 @@ freemapentry(mapentry *ent)
 	} while (ent != NULL);
 }
 
+/**
+ * Frees all resources allocated for a tmmap. The values stored in the
+ * map are not freed.
+ *
+ * @param map Pointer to the map which should be freed.
+ */
+static void
+freetmmap(tmmap *map)
+{
+	size_t i;
+
+	for (i = 0; i < map->size; i++)
+		if (map->entries[i])
+			freemapentry(map->entries[i]);
+
+	free(map->entries);
+	free(map);
+}
+
 /**
  * Adds a new value to the tmmap, if the key is not already present.
  *
@@ -171,23 +193,36 @@ getval(tmmap *map, mapkey key, mapentry **dest)
 }
 
 /**
- * Allocates memory for a new tape entry and initializes it.
+ * Removes the associated value for a given key from the map.
  *
- * @param value Symbol of this tape entry.
- * @param prev Entry on the left hand side of this one.
- * @param next Entry on the right hand side of this one.
- * @returns Pointer to the newly created tape entry.
+ * @param map Map from which the key should be removed.
+ * @param key Key which should be removed.
+ * @param dest Pointer to mapentry used to store the removed entry. The
+ * 	entry is no longer part of the map and must be freed by the caller.
+ * @returns -1 if a value for the given key didn't exist, 0 otherwise.
  */
-static tapeentry *
-newtapeentry(char value, tapeentry *prev, tapeentry *next)
+static int
+delval(tmmap *map, mapkey key, mapentry **dest)
 {
-	tapeentry *entr;
+	size_t idx;
+	mapentry *prev, *next;
+
+	idx = hash(map, key);
+	for (prev = NULL, next = map->entries[idx];
+	     next != NULL && next->key != key; next = next->next)
+		prev = next;
+
+	if (next == NULL)
+		return -1;
 
-	entr = emalloc(sizeof(tapeentry));
-	entr->value = value;
-	entr->next = next;
-	entr->prev = prev;
-	return entr;
+	if (prev == NULL)
+		map->entries[idx] = next->next;
+	else
+		prev->next = next->next;
+
+	next->next = NULL;
+	*dest = next;
+	return 0;
 }
 
 /**
@@ -200,12 +235,68 @@ newtmstate(void)
 {
 	tmstate *state;
 
-	state = emalloc(sizeof(tmstate));
+	state = tagalloc(MEM_MACHINE, sizeof(tmstate));
 	state->name = 0;
 	state->trans = newtmmap(TRANSMAPSIZ);
+	state->dead = 0;
 	return state;
 }
 
+/**
+ * Allocates memory for a new transition and initializes it. The
+ * transition reads and writes blanks, doesn't move the head and isn't
+ * part of a multi-tape machine.
+ *
+ * @returns Pointer to the newly created transition.
+ */
+tmtrans *
+newtrans(void)
+{
+	size_t i;
+	tmtrans *trans;
+
+	trans = tagalloc(MEM_MACHINE, sizeof(tmtrans));
+	trans->rsym = trans->wsym = BLANKCHAR;
+	trans->headdir = STAY;
+	trans->nextstate = 0;
+	trans->count = trans->id = 0;
+	trans->steps = 1;
+	trans->alt = NULL;
+
+	memset(trans->xrsym, 0, sizeof(trans->xrsym));
+	memset(trans->xwsym, 0, sizeof(trans->xwsym));
+	for (i = 0; i < TMMAXTAPES - 1; i++)
+		trans->xdir[i] = STAY;
+
+	return trans;
+}
+
+/**
+ * Frees all resources allocated for a state including its transitions.
+ *
+ * @param state Pointer to the state which should be freed.
+ */
+void
+freetmstate(tmstate *state)
+{
+	size_t i;
+	mapentry *elem, *next;
+
+	assert(state);
+
+	for (i = 0; i < state->trans->size; i++) {
+		for (elem = state->trans->entries[i]; elem; elem = next) {
+			next = elem->next;
+			freetrans(elem->data.trans);
+			free(elem);
+		}
+	}
+
+	free(state->trans->entries);
+	free(state->trans);
+	free(state);
+}
+
 /**
  * Allocates memory for a new turing maschine and initializes it.
  *
@@ -214,17 +305,54 @@ newtmstate(void)
 dtm *
 newtm(void)
 {
+	size_t i;
 	dtm *tm;
 
-	tm = emalloc(sizeof(dtm));
+	tm = tagalloc(MEM_MACHINE, sizeof(dtm));
 	tm->states = newtmmap(STATEMAPSIZ);
 	tm->start = 0;
-	tm->tape = newtapeentry(BLANKCHAR, NULL, NULL);
-	tm->accept = emalloc(ACCEPTSTEP * sizeof(tmname));
+	tm->tape = newtape();
+	tm->ntapes = 1;
+	for (i = 0; i < TMMAXTAPES - 1; i++)
+		tm->xtape[i] = NULL;
+	tm->accept = tagalloc(MEM_MACHINE, ACCEPTSTEP * sizeof(tmname));
 	tm->acceptsiz = 0;
+	tm->profile = 0;
+	tm->steps = 0;
+	tm->trace = NULL;
+	tm->cur = 0;
+	tm->curhead = 0;
+	tm->hook = NULL;
+	tm->hookarg = NULL;
+	tm->hookat = ULONG_MAX;
 	return tm;
 }
 
+/**
+ * Frees all resources allocated for a turing maschine including its
+ * states, transitions and tape.
+ *
+ * @param tm Pointer to the turing maschine which should be freed.
+ */
+void
+freetm(dtm *tm)
+{
+	size_t i;
+	mapentry *elem;
+
+	assert(tm);
+
+	MAP_FOREACH (tm->states, elem, i)
+		freetmstate(elem->data.state);
+	freetmmap(tm->states);
+
+	freetape(tm->tape);
+	for (i = 0; i + 1 < tm->ntapes; i++)
+		freetape(tm->xtape[i]);
+	free(tm->accept);
+	free(tm);
+}
+
 /**
  * Adds an accepting state (identified by name) to a turing maschine.
  *
@@ -238,12 +366,32 @@ addaccept(dtm *tm, tmname state)
 
 	if (tm->acceptsiz && tm->acceptsiz % ACCEPTSTEP == 0) {
 		newsiz = (tm->acceptsiz + ACCEPTSTEP) * sizeof(tmname);
-		tm->accept = erealloc(tm->accept, newsiz);
+		tm->accept = tagrealloc(MEM_MACHINE, tm->accept,
+			tm->acceptsiz * sizeof(tmname), newsiz);
 	}
 
 	tm->accept[tm->acceptsiz++] = state;
 }
 
+/**
+ * Sets the amount of tapes of a turing maschine. The additional tapes
+ * are blank and the head of each is positioned on an accessed cell.
+ *
+ * @param tm Turing maschine whose amount of tapes should be set.
+ * @param n Amount of tapes, at least the current amount and at most
+ * 	TMMAXTAPES.
+ */
+void
+settapes(dtm *tm, size_t n)
+{
+	assert(n >= tm->ntapes && n <= TMMAXTAPES);
+
+	for (; tm->ntapes < n; tm->ntapes++) {
+		tm->xtape[tm->ntapes - 1] = newtape();
+		extendtape(tm->xtape[tm->ntapes - 1]);
+	}
+}
+
 /**
  * Adds a new state to an existing turing maschine.
  *
@@ -287,6 +435,118 @@ getstate(dtm *tm, tmname name, tmstate **dest)
 	return ret;
 }
 
+/**
+ * Removes a state from an existing turing machine and frees it.
+ *
+ * @param tm Turing machine from which a state should be removed.
+ * @param name Name of the state that should be removed.
+ * @returns -1 if the state doesn't exist, 0 otherwise.
+ */
+int
+delstate(dtm *tm, tmname name)
+{
+	int ret;
+	mapentry *entry;
+
+	if ((ret = delval(tm->states, name, &entry)))
+		return ret;
+
+	freetmstate(entry->data.state);
+	freemapentry(entry);
+	return ret;
+}
+
+/**
+ * Copies the given transition and adds the copy to the state passed
+ * as argument.
+ *
+ * @param trans Transition which should be copied.
+ * @param state State the transition belongs to, unused.
+ * @param arg Void pointer to the state the copy should be added to.
+ */
+static void
+copytrans(tmtrans *trans, tmstate *state, void *arg)
+{
+	tmtrans *copy, **alt;
+
+	(void)state;
+
+	copy = tagalloc(MEM_MACHINE, sizeof(tmtrans));
+	*copy = *trans;
+	for (alt = &copy->alt; *alt; alt = &(*alt)->alt) {
+		trans = *alt;
+		*alt = tagalloc(MEM_MACHINE, sizeof(tmtrans));
+		**alt = *trans;
+	}
+
+	/* Can't fail, the original state has no duplicate transitions. */
+	(void)addtrans(arg, copy);
+}
+
+/**
+ * Replaces all states of an existing turing machine with copies of
+ * the given states. The copies and their transitions are allocated in
+ * the order of the given array, states which are frequently accessed
+ * together should therefore be adjacent in this array. The state map
+ * is resized to contain at least one bucket per state.
+ *
+ * @pre The given array must contain all states of the turing machine.
+ * @param tm Turing machine whose states should be relocated.
+ * @param states Array of the states in the desired memory order. The
+ * 	array is updated to point to the relocated states.
+ * @param n Amount of states in the array.
+ */
+void
+relocstates(dtm *tm, tmstate **states, size_t n)
+{
+	size_t i;
+	tmstate *copy, **old;
+
+	freetmmap(tm->states);
+	tm->states = newtmmap((n > STATEMAPSIZ) ? n : STATEMAPSIZ);
+
+	/* Copy all states before freeing the old ones to prevent the
+	 * allocator from reusing the freed memory in reverse order. */
+	old = tagalloc(MEM_MACHINE, (n + 1) * sizeof(tmstate *));
+	for (i = 0; i < n; i++) {
+		copy = newtmstate();
+		copy->name = states[i]->name;
+		copy->dead = states[i]->dead;
+		eachtrans(states[i], copytrans, copy);
+
+		/* Can't fail, the given states have distinct names. */
+		(void)addstate(tm, copy);
+
+		old[i] = states[i];
+		states[i] = copy;
+	}
+
+	for (i = 0; i < n; i++)
+		freetmstate(old[i]);
+	free(old);
+}
+
+/**
+ * Packs the symbols read by the given transition from all tapes into
+ * the key used for the transition map. The key of a transition of a
+ * single-tape machine is the symbol itself.
+ *
+ * @param trans Transition whose key should be calculated.
+ * @returns Key of the transition.
+ */
+static mapkey
+transkey(tmtrans *trans)
+{
+	size_t i;
+	mapkey key;
+
+	key = trans->rsym;
+	for (i = 0; i < TMMAXTAPES - 1; i++)
+		key |= (mapkey)trans->xrsym[i] << ((i + 1) * TUPLEBITS);
+
+	return key;
+}
+
 /**
  * Adds a transition to an existing turing maschine state.
  *
@@ -300,7 +560,7 @@ addtrans(tmstate *state, tmtrans *trans)
 	int ret;
 	mapentry *entry;
 
-	entry = newmapentry(trans->rsym);
+	entry = newmapentry(transkey(trans));
 	entry->data.trans = trans;
 
 	if ((ret = setval(state->trans, entry)))
@@ -310,7 +570,24 @@ addtrans(tmstate *state, tmtrans *trans)
 }
 
 /**
- * Retrieves a transition from an existing turing state.
+ * Frees a transition including its alternatives.
+ *
+ * @param trans Transition which should be freed.
+ */
+void
+freetrans(tmtrans *trans)
+{
+	tmtrans *alt;
+
+	for (; trans; trans = alt) {
+		alt = trans->alt;
+		free(trans);
+	}
+}
+
+/**
+ * Retrieves a transition from an existing turing state. Transitions
+ * of multi-tape machines can't be retrieved using this function.
  *
  * @param state State from which a transition should be extracted.
  * @param rsym Symbol which triggers the tranisition.
@@ -330,6 +607,27 @@ gettrans(tmstate *state, char rsym, tmtrans **dest)
 	return ret;
 }
 
+/**
+ * Removes a transition from an existing turing state and frees it.
+ *
+ * @param state State from which a transition should be removed.
+ * @param rsym Symbol which triggers the tranisition.
+ * @returns -1 if a transition with the given symbol doesn't exist, 0 otherwise.
+ */
+int
+deltrans(tmstate *state, char rsym)
+{
+	int ret;
+	mapentry *entry;
+
+	if ((ret = delval(state->trans, rsym, &entry)))
+		return ret;
+
+	freetrans(entry->data.trans);
+	freemapentry(entry);
+	return ret;
+}
+
 /**
  * Writes the given string to the tape of the given turing maschine.
  *
@@ -339,19 +637,7 @@ gettrans(tmstate *state, char rsym, tmtrans **dest)
 void
 writetape(dtm *tm, char *str)
 {
-	char c;
-	tapeentry *ent, *last;
-
-	last = tm->tape;
-	for (ent = tm->tape; ent; ent = ent->next)
-		last = ent;
-	assert(last);
-
-	while ((c = *str++)) {
-		ent = newtapeentry(c, last, NULL);
-		last->next = ent;
-		last = ent;
-	}
+	appendtape(tm->tape, str);
 }
 
 /**
@@ -372,13 +658,7 @@ writetape(dtm *tm, char *str)
 void
 printtape(dtm *tm)
 {
-	tapeentry *c, *s;
-
-	for (s = tm->tape; s->prev; s = s->prev)
-		;
-
-	for (c = s; c; c = c->next)
-		putchar(c->value);
+	printcells(tm->tape, stdout);
 	putchar('\n');
 }
 
@@ -389,7 +669,7 @@ printtape(dtm *tm)
  * @param name State name to check.
  * @returns 0 if it does, -1 if it doesn't.
  */
-static int
+int
 isaccepting(dtm *tm, tmname name)
 {
 	size_t i;
@@ -402,8 +682,25 @@ isaccepting(dtm *tm, tmname name)
 }
 
 /**
- * Performs transitions form the given state tail recursively until a state
- * without any new transitions for the current tape symbol is reached.
+ * Returns the offset of the head from the leftmost accessed cell of
+ * the given tape, as published to the sampling profiler.
+ *
+ * @param t Tape whose head offset should be returned.
+ * @returns Offset of the head, limited to SIG_ATOMIC_MAX.
+ */
+static inline sig_atomic_t
+headoff(tmtape *t)
+{
+	size_t off;
+
+	off = t->head - t->lo;
+	return (off > SIG_ATOMIC_MAX) ? SIG_ATOMIC_MAX : (sig_atomic_t)off;
+}
+
+/**
+ * Performs transitions form the given state until a state without any
+ * new transitions for the current tape symbol is reached or until a
+ * state marked as dead by ::markdead is entered.
  *
  * @param tm Turing machine to perform transitions on.
  * @param state State to perform transitions from.
@@ -414,41 +711,165 @@ compute(dtm *tm, tmstate *state)
 {
 	char in;
 	tmtrans *trans;
-	static tmstate *next; /* static to enable tail call optimization. */
 
-	if (!tm->tape->next)
-		tm->tape->next = newtapeentry(BLANKCHAR, tm->tape, NULL);
+	for (;;) {
+		tm->cur = state->name;
+		tm->curhead = headoff(tm->tape);
+		if (tm->tape->head > tm->tape->hi && readinput(tm->tape)) {
+			if (tm->tape->inerr)
+				return -1;
+			extendtape(tm->tape);
+		}
 
-	in = tm->tape->next->value;
-	if (gettrans(state, in, &trans))
-		return isaccepting(tm, state->name);
+		in = readsym(tm->tape);
+		if (gettrans(state, in, &trans))
+			return isaccepting(tm, state->name);
 
-	tm->tape->next->value = trans->wsym;
-	switch (trans->headdir) {
+		/* Only invoked if a further step is actually performed,
+		 * a machine halting within its budget isn't stopped. */
+		if (tm->steps >= tm->hookat &&
+				tm->hook(tm, state->name, tm->hookarg))
+			return -1;
+		if (tm->profile)
+			trans->count++;
+		if (tm->trace)
+			tracetrans(tm->trace, trans);
+		tm->steps += trans->steps;
+
+		writesym(tm->tape, trans->wsym);
+		switch (trans->headdir) {
+		case RIGHT:
+			headright(tm->tape);
+			break;
+		case LEFT:
+			headleft(tm->tape);
+			break;
+		case STAY:
+			/* Nothing to do here. */
+			break;
+		}
+
+		if (getstate(tm, trans->nextstate, &state))
+			return isaccepting(tm, trans->nextstate);
+		else if (state->dead)
+			return -1;
+	}
+}
+
+/**
+ * Moves the head of an additional tape of a multi-tape machine. The
+ * cell the head is positioned on afterwards is considered accessed.
+ *
+ * @param t Tape whose head should be moved.
+ * @param dir Direction the head should be moved to.
+ */
+static void
+movehead(tmtape *t, direction dir)
+{
+	switch (dir) {
 	case RIGHT:
-		tm->tape = tm->tape->next;
+		headright(t);
+		if (t->head > t->hi)
+			extendtape(t);
 		break;
 	case LEFT:
-		if (!tm->tape->prev)
-			tm->tape->prev = newtapeentry(BLANKCHAR, NULL,
-			                              tm->tape);
-		tm->tape = tm->tape->prev;
+		headleft(t);
 		break;
 	case STAY:
 		/* Nothing to do here. */
 		break;
 	}
+}
 
-	if (getstate(tm, trans->nextstate, &next))
-		return isaccepting(tm, trans->nextstate);
+/**
+ * Performs transitions of a multi-tape machine like ::compute. The
+ * transition is looked up using the symbols read from all tapes,
+ * the input is read from the first tape.
+ *
+ * @param tm Multi-tape turing machine to perform transitions on.
+ * @param state State to perform transitions from.
+ * @return 0 if the reached state is an accepting state, -1 otherwise.
+ */
+static int
+computemulti(dtm *tm, tmstate *state)
+{
+	size_t i;
+	mapkey key;
+	mapentry *entry;
+	tmtrans *trans;
+
+	for (;;) {
+		tm->cur = state->name;
+		tm->curhead = headoff(tm->tape);
+		if (tm->tape->head > tm->tape->hi && readinput(tm->tape)) {
+			if (tm->tape->inerr)
+				return -1;
+			extendtape(tm->tape);
+		}
 
-	return compute(tm, next);
+		key = readsym(tm->tape);
+		for (i = 0; i + 1 < tm->ntapes; i++)
+			key |= (mapkey)readsym(tm->xtape[i]) << ((i + 1) * TUPLEBITS);
+		if (getval(state->trans, key, &entry))
+			return isaccepting(tm, state->name);
+		if (tm->steps >= tm->hookat &&
+				tm->hook(tm, state->name, tm->hookarg))
+			return -1;
+
+		trans = entry->data.trans;
+		if (tm->profile)
+			trans->count++;
+		tm->steps += trans->steps;
+
+		writesym(tm->tape, trans->wsym);
+		switch (trans->headdir) {
+		case RIGHT:
+			headright(tm->tape);
+			break;
+		case LEFT:
+			headleft(tm->tape);
+			break;
+		case STAY:
+			/* Nothing to do here. */
+			break;
+		}
+
+		for (i = 0; i + 1 < tm->ntapes; i++) {
+			writesym(tm->xtape[i], trans->xwsym[i]);
+			movehead(tm->xtape[i], trans->xdir[i]);
+		}
+
+		if (getstate(tm, trans->nextstate, &state))
+			return isaccepting(tm, trans->nextstate);
+		else if (state->dead)
+			return -1;
+	}
+}
+
+/**
+ * Hook stopping a run as soon as its step budget, the hookat field of
+ * the machine, is exhausted. Installed by callers of ::runtm which
+ * need to limit the amount of steps.
+ *
+ * @param tm Turing machine which exhausted its budget, unused.
+ * @param state Name of the current state, unused.
+ * @param arg Void pointer to an int flag which is set to 1.
+ * @returns Always -1, the machine stops.
+ */
+int
+budgethook(dtm *tm, tmname state, void *arg)
+{
+	(void)tm;
+	(void)state;
+
+	*(int *)arg = 1;
+	return -1;
 }
 
 /**
  * Starts the turing machine. Meaning it will extract the initial state from
- * the given tm and will perform transitions (tail recursively) from this state
- * until a state without any further transitions is reached.
+ * the given tm and will perform transitions from this state until a state
+ * without any further transitions is reached.
  *
  * @param tm Turing machine which should be started.
  * @return 0 if the reached state is an accepting state, -1 otherwise.
@@ -458,13 +879,86 @@ runtm(dtm *tm)
 {
 	tmstate *start;
 
-	/* tm->tape->next is only NULL here if the user supplied the
-	 * empty word as an input for this turing maschine. In that
+	/* The head is only positioned on a cell which wasn't accessed
+	 * yet, and no further input can be read, if the user supplied
+	 * the empty word as an input for this turing maschine. In that
 	 * case we don't want to perform any further transitions. */
-	if (getstate(tm, tm->start, &start) || !tm->tape->next)
+	if (getstate(tm, tm->start, &start) ||
+			(tm->tape->head > tm->tape->hi && readinput(tm->tape)))
 		return isaccepting(tm, tm->start);
+	else if (start->dead)
+		return -1;
+
+	return (tm->ntapes > 1) ? computemulti(tm, start) : compute(tm, start);
+}
+
+/**
+ * Performs a single transition of the turing machine, starting in the
+ * given state. The tape is accessed exactly as by ::runtm, running the
+ * machine step by step thus yields the same tape.
+ *
+ * @pre The cell the head is positioned on must have been accessed.
+ * @param tm Turing machine which should perform the transition.
+ * @param name Pointer to the name of the current state, updated to
+ * 	the name of the next state if a transition was performed.
+ * @param dest Pointer to memory area where a pointer to the performed
+ * 	transition is stored.
+ * @return 0 if a transition was performed, -1 if the machine halted.
+ */
+int
+steptm(dtm *tm, tmname *name, tmtrans **dest)
+{
+	tmstate *state;
+	tmtrans *trans;
+
+	if (getstate(tm, *name, &state) || state->dead ||
+			gettrans(state, readsym(tm->tape), &trans))
+		return -1;
+	tm->steps += trans->steps;
+
+	writesym(tm->tape, trans->wsym);
+	switch (trans->headdir) {
+	case RIGHT:
+		headright(tm->tape);
+		break;
+	case LEFT:
+		headleft(tm->tape);
+		break;
+	case STAY:
+		/* Nothing to do here. */
+		break;
+	}
+
+	/* The interpreter only accesses the next cell if it continues. */
+	*name = trans->nextstate;
+	if (!getstate(tm, *name, &state) && !state->dead &&
+			tm->tape->head > tm->tape->hi && readinput(tm->tape))
+		extendtape(tm->tape);
+
+	*dest = trans;
+	return 0;
+}
+
+/**
+ * Continues a turing machine whose tape and step count were restored,
+ * e.g. from a checkpoint. Unlike ::runtm the machine is started in the
+ * given state and at least one transition is attempted.
+ *
+ * @param tm Turing machine which should be continued.
+ * @param name Name of the state the machine should continue in.
+ * @return 0 if the reached state is an accepting state, -1 otherwise.
+ */
+int
+resumetm(dtm *tm, tmname name)
+{
+	tmstate *state;
+
+	if (getstate(tm, name, &state))
+		return isaccepting(tm, name);
+	else if (state->dead)
+		return -1;
 
-	return compute(tm, start);
+	return (tm->ntapes > 1) ? computemulti(tm, state) : compute(tm, state);
 }
 
 /**
@@ -525,6 +1019,29 @@ dirstr(direction dir)
 	return -1;
 }
 
+/**
+ * Returns the symbol used for the given direction in the tmsim input
+ * format.
+ *
+ * @param dir Direction which should be converted.
+ * @returns Symbol representing the direction.
+ */
+int
+dirsym(direction dir)
+{
+	switch (dir) {
+	case RIGHT:
+		return '>';
+	case LEFT:
+		return '<';
+	case STAY:
+		return '|';
+	}
+
+	/* Never reached. */
+	return -1;
+}
+
 /**
  * Verifies the given input string ensuring that it only consists of
  * alphanumeric characters and digits. Besides it ensures that it doesn't
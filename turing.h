@@ -19,8 +19,12 @@
 #ifndef TMSIM_TURING_H
 #define TMSIM_TURING_H
 
+#include <signal.h>
+
 #include <sys/types.h>
 
+#include "tape.h"
+
 enum {
 	/**
 	 * Amount of buckets used for the state map.
@@ -41,6 +45,18 @@ enum {
 	 * Character used to represent blanks on the tape.
 	 */
 	BLANKCHAR = '$',
+
+	/**
+	 * Maximum amount of tapes of a multi-tape machine. The symbols
+	 * read from all tapes are packed into a single ::mapkey using
+	 * TUPLEBITS bits per tape.
+	 */
+	TMMAXTAPES = 4,
+
+	/**
+	 * Bits used per tape symbol in a packed read tuple.
+	 */
+	TUPLEBITS = 7,
 };
 
 /**
@@ -100,6 +116,13 @@ struct _tmmap {
 struct _tmstate {
 	tmname name;  /**< Name of this tmstate. */
 	tmmap *trans; /**< Transitions for this state. */
+
+	/**
+	 * Non-zero if no accepting state is reachable from this state.
+	 * Set by ::markdead, the interpreter rejects the input as soon
+	 * as a dead state is entered.
+	 */
+	int dead;
 };
 
 struct _tmtrans {
@@ -115,28 +138,60 @@ struct _tmtrans {
 	 */
 	char wsym;
 
+	/**
+	 * Symbols which need to be read from the additional tapes of a
+	 * multi-tape machine, starting with the second tape. Together
+	 * with rsym they form the key of this transition in the tmmap.
+	 * Unused entries are zero.
+	 */
+	char xrsym[TMMAXTAPES - 1];
+
+	/**
+	 * Symbols written to the additional tapes of a multi-tape machine.
+	 */
+	char xwsym[TMMAXTAPES - 1];
+
 	/**
 	 * Direction to move head to after performing this transition.
 	 */
 	direction headdir;
 
+	/**
+	 * Directions to move the heads of the additional tapes to.
+	 */
+	direction xdir[TMMAXTAPES - 1];
+
 	/**
 	 * Name of the state the turing machine switches to after writing
 	 * the associated symbol to the tape and moving the head to the
 	 * associated direction.
 	 */
 	tmname nextstate;
-};
 
-/**
- * Double linked list used for entries on the tape of the turing machine.
- */
-typedef struct _tapeentry tapeentry;
+	/**
+	 * Amount of times this transition was performed. Only updated
+	 * if profiling is enabled for the turing machine.
+	 */
+	unsigned long count;
+
+	/**
+	 * Amount of steps performed by this transition. Transitions
+	 * fused with their successors by ::fuse perform more than one.
+	 */
+	unsigned long steps;
+
+	/**
+	 * Identifier of this transition in an execution trace. Assigned
+	 * by ::newtrace.
+	 */
+	unsigned long id;
 
-struct _tapeentry {
-	char value;      /**< Symbol for this tape entry. */
-	tapeentry *next; /**< Entry on the right-hand side of this one. */
-	tapeentry *prev; /**< Entry on the left-hand side of this one. */
+	/**
+	 * Next alternative transition for the same symbol. Only used by
+	 * nondeterministic machines, NULL otherwise. Alternatives are
+	 * owned by the transition stored in the state.
+	 */
+	tmtrans *alt;
 };
 
 /**
@@ -145,23 +200,65 @@ struct _tapeentry {
 typedef struct _dtm dtm;
 
 struct _dtm {
-	tapeentry *tape; /**< Tape content. */
-	tmmap *states;   /**< Map of all states. */
-	tmname start;    /**< Initial state. */
+	tmtape *tape;  /**< Tape content, the input is written to it. */
+
+	size_t ntapes; /**< Amount of tapes, at most TMMAXTAPES. */
+	tmtape *xtape[TMMAXTAPES - 1]; /**< Additional tapes or NULL. */
+
+	tmmap *states; /**< Map of all states. */
+	tmname start;  /**< Initial state. */
 
 	tmname *accept;   /**< Pointer to array of accepting states. */
 	size_t acceptsiz; /**< Amount of accepting states. */
+
+	int profile;         /**< Whether performed transitions are counted. */
+	unsigned long steps; /**< Amount of steps performed so far. */
+
+	struct _tmtrace *trace; /**< Trace being recorded or NULL. */
+
+	/**
+	 * Name of the current state while the machine is running. Only
+	 * written by the interpreter, read asynchronously by the sampling
+	 * profiler.
+	 */
+	volatile sig_atomic_t cur;
+
+	/**
+	 * Offset of the head from the leftmost accessed cell while the
+	 * machine is running, limited to SIG_ATOMIC_MAX. Like cur only
+	 * written by the interpreter, the sampling profiler can't read
+	 * the tape itself since it may be resized at the same time.
+	 */
+	volatile sig_atomic_t curhead;
+
+	/**
+	 * Function invoked by the interpreter before a transition once the
+	 * amount of performed steps reaches hookat. The function receives
+	 * the name of the current state and is expected to update hookat.
+	 * If it returns non-zero the machine stops and rejects the input.
+	 */
+	int (*hook)(dtm *, tmname, void *);
+	void *hookarg;         /**< Additional argument passed to the hook. */
+	unsigned long hookat;  /**< Step count at which the hook is invoked. */
 };
 
 dtm *newtm(void);
+void freetm(dtm *);
 tmstate *newtmstate(void);
+void freetmstate(tmstate *);
 void addaccept(dtm *, tmname);
+void settapes(dtm *, size_t);
 
+tmtrans *newtrans(void);
 int addtrans(tmstate *, tmtrans *);
+void freetrans(tmtrans *);
 int gettrans(tmstate *, char, tmtrans **);
+int deltrans(tmstate *, char);
 
 int addstate(dtm *, tmstate *);
 int getstate(dtm *, tmname, tmstate **);
+int delstate(dtm *, tmname);
+void relocstates(dtm *, tmstate **, size_t);
 
 void writetape(dtm *, char *);
 void printtape(dtm *);
@@ -170,7 +267,12 @@ void eachstate(dtm *, void (*fn)(tmstate *, void *), void *);
 void eachtrans(tmstate *, void (*fn)(tmtrans *, tmstate *, void *), void *);
 
 int runtm(dtm *);
+int resumetm(dtm *, tmname);
+int steptm(dtm *, tmname *, tmtrans **);
+int isaccepting(dtm *, tmname);
+int budgethook(dtm *, tmname, void *);
 int dirstr(direction);
+int dirsym(direction);
 int verifyinput(char *, size_t *);
 
 #endif
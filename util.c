@@ -21,6 +21,7 @@
 #include <fcntl.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -131,6 +132,45 @@ endofline(char *line)
 	return (size_t)(pos - line);
 }
 
+/**
+ * Splits a buffer into lines. A single newline at the end of the
+ * buffer is ignored, the content of the lines isn't examined.
+ *
+ * @param buf Buffer which should be split, not necessarily terminated.
+ * @param len Length of the buffer.
+ * @param offs Pointer to store an allocated array containing the
+ * 	offset of each line at.
+ * @param lens Pointer to store an allocated array containing the
+ * 	length of each line, excluding the newline, at.
+ * @returns Amount of lines.
+ */
+size_t
+splitlines(char *buf, size_t len, size_t **offs, size_t **lens)
+{
+	size_t i, n, start;
+
+	for (n = 0, i = 0; i < len; i++)
+		if (buf[i] == '\n')
+			n++;
+	if (len && buf[len - 1] != '\n')
+		n++;
+
+	*offs = emalloc((n ? n : 1) * sizeof(size_t));
+	*lens = emalloc((n ? n : 1) * sizeof(size_t));
+	for (n = 0, start = 0, i = 0; i <= len; i++) {
+		if (i < len && buf[i] != '\n')
+			continue;
+		else if (i == len && start == i)
+			break;
+
+		(*offs)[n] = start;
+		(*lens)[n++] = i - start;
+		start = i + 1;
+	}
+
+	return n;
+}
+
 /**
  * Compares the first 'n' bytes of two strings (like strncmp(3)).
  * However, unlike strncmp(3) it returns the position of the
@@ -215,6 +255,36 @@ estrndup(char *s, size_t n)
 	return r;
 }
 
+/**
+ * Whether allocations are accounted to their subsystem.
+ */
+static int accounting = 0;
+
+/**
+ * Bytes requested and amount of allocations for each subsystem. The
+ * counters are updated atomically since allocations are performed by
+ * multiple threads, e.g. the scanner and the worker threads. Only the
+ * final values are of interest, relaxed ordering thus suffices.
+ */
+static size_t membytes[MEM_NTAGS], memcalls[MEM_NTAGS];
+
+/**
+ * Adds an allocation of the given size to the counters of the given
+ * subsystem if accounting was enabled using ::memaccount.
+ *
+ * @param tag Subsystem the allocation belongs to.
+ * @param size Amount of bytes requested.
+ */
+static void
+account(memtag tag, size_t size)
+{
+	if (!accounting)
+		return;
+
+	(void)__atomic_add_fetch(&membytes[tag], size, __ATOMIC_RELAXED);
+	(void)__atomic_add_fetch(&memcalls[tag], 1, __ATOMIC_RELAXED);
+}
+
 /**
  * Calls malloc(3) but terminates the program with EXIT_FAILURE if malloc
  * returned an error.
@@ -224,33 +294,97 @@ estrndup(char *s, size_t n)
  */
 void *
 emalloc(size_t size)
+{
+	return tagalloc(MEM_OTHER, size);
+}
+
+/**
+ * Calls realloc(3) but terminates the program with EXIT_FAILURE if realloc
+ * returned an error. The previous size is unknown, the entire new size
+ * is thus accounted. Buffers which are grown repeatedly should use
+ * ::tagrealloc instead.
+ *
+ * @param size Amount of memory (in bytes) which should be allocated.
+ * @returns Pointer to the allocated memory.
+ */
+void *
+erealloc(void *ptr, size_t size)
+{
+	void *r;
+
+	if (!(r = realloc(ptr, size)))
+		die("realloc failed");
+
+	account(MEM_OTHER, size);
+	return r;
+}
+
+/**
+ * Like ::emalloc but accounts the allocation to the given subsystem.
+ *
+ * @param tag Subsystem the allocation belongs to.
+ * @param size Amount of memory (in bytes) which should be allocated.
+ * @returns Pointer to the allocated memory.
+ */
+void *
+tagalloc(memtag tag, size_t size)
 {
 	void *r;
 
 	if (!(r = malloc(size)))
 		die("malloc failed");
 
+	account(tag, size);
 	return r;
 }
 
 /**
- * Calls realloc(3) but terminates the program with EXIT_FAILURE if realloc
- * returned an error.
+ * Like ::erealloc but accounts the allocation to the given subsystem.
+ * Only the growth of the buffer is accounted, repeatedly growing a
+ * buffer thus accounts the final size of the buffer.
  *
+ * @param tag Subsystem the allocation belongs to.
+ * @param ptr Pointer to the memory which should be reallocated.
+ * @param oldsiz Current size of the memory (in bytes).
  * @param size Amount of memory (in bytes) which should be allocated.
  * @returns Pointer to the allocated memory.
  */
 void *
-erealloc(void *ptr, size_t size)
+tagrealloc(memtag tag, void *ptr, size_t oldsiz, size_t size)
 {
 	void *r;
 
 	if (!(r = realloc(ptr, size)))
 		die("realloc failed");
 
+	account(tag, (size > oldsiz) ? size - oldsiz : 0);
 	return r;
 }
 
+/**
+ * Enables accounting of allocations. Must be called before any
+ * additional threads are started.
+ */
+void
+memaccount(void)
+{
+	accounting = 1;
+}
+
+/**
+ * Retrieves the allocation counters of the given subsystem.
+ *
+ * @param tag Subsystem whose counters should be retrieved.
+ * @param bytes Pointer to store the amount of bytes requested at.
+ * @param calls Pointer to store the amount of allocations at.
+ */
+void
+memusage(memtag tag, size_t *bytes, size_t *calls)
+{
+	*bytes = __atomic_load_n(&membytes[tag], __ATOMIC_RELAXED);
+	*calls = __atomic_load_n(&memcalls[tag], __ATOMIC_RELAXED);
+}
+
 /**
  * Calls pthread_mutex_lock(3) but terminates the program with
  * EXIT_FAILURE if pthread_mutex_lock returned an error.
@@ -302,3 +436,48 @@ sem_epost(sem_t *sem)
 	if (sem_post(sem))
 		die("sem_post failed");
 }
+
+/**
+ * Writes an unsigned integer using a variable-length encoding with
+ * seven bits per byte, least significant bits first.
+ *
+ * @param stream Stream to write the integer to.
+ * @param val Integer which should be written.
+ */
+void
+putvarint(FILE *stream, uint64_t val)
+{
+	while (val >= 0x80) {
+		putc((int)(val & 0x7f) | 0x80, stream);
+		val >>= 7;
+	}
+	putc((int)val, stream);
+}
+
+/**
+ * Reads an unsigned integer written by ::putvarint.
+ *
+ * @param stream Stream to read the integer from.
+ * @param dest Pointer to memory area where the integer should be stored.
+ * @returns 0 on success, -1 on end of file or if the integer is invalid.
+ */
+int
+getvarint(FILE *stream, uint64_t *dest)
+{
+	int ch;
+	unsigned int shift;
+	uint64_t val;
+
+	val = 0;
+	for (shift = 0; shift < 64; shift += 7) {
+		if ((ch = getc(stream)) == EOF)
+			return -1;
+		val |= (uint64_t)(ch & 0x7f) << shift;
+		if (!(ch & 0x80)) {
+			*dest = val;
+			return 0;
+		}
+	}
+
+	return -1;
+}
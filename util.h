@@ -21,6 +21,7 @@
 
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -37,16 +38,35 @@
 		exit(EXIT_FAILURE); \
 	} while (0)
 
+/**
+ * Subsystem an allocation is accounted to, see ::tagalloc.
+ */
+typedef enum {
+	MEM_PARSER,  /**< Scanner, tokens and parser. */
+	MEM_MACHINE, /**< States, transitions and state maps. */
+	MEM_TAPE,    /**< Tapes and their cell buffers. */
+	MEM_OTHER,   /**< Everything allocated using ::emalloc. */
+	MEM_NTAGS,   /**< Amount of tags, not a valid tag. */
+} memtag;
+
 int xstrncmp(char *, char *, size_t, size_t *);
 ssize_t readfile(char **, char *);
 char *mark(size_t, char *);
 
 char *linenum(char *, unsigned int);
 size_t endofline(char *);
+size_t splitlines(char *, size_t, size_t **, size_t **);
 
 char *estrndup(char *, size_t);
 void *emalloc(size_t);
 void *erealloc(void *, size_t);
+void *tagalloc(memtag, size_t);
+void *tagrealloc(memtag, void *, size_t, size_t);
+void memaccount(void);
+void memusage(memtag, size_t *, size_t *);
+
+void putvarint(FILE *, uint64_t);
+int getvarint(FILE *, uint64_t *);
 
 void pthread_mutex_elock(pthread_mutex_t *);
 void pthread_mutex_eunlock(pthread_mutex_t *);